@@ -5,6 +5,9 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/memprof.h"
+#include "threads/spinlock.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -127,6 +130,9 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  lock_print_stats ();
+  spinlock_print_stats ();
+  memprof_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
@@ -5,6 +5,7 @@
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "devices/block.h"
 #include "threads/thread.h"
 
@@ -25,6 +26,18 @@ struct dir_entry
   bool in_use;                        /* In use or free? */
 };
 
+/* Cache of `struct dir's. */
+static struct kmem_cache *dir_cache;
+
+/* Initializes the directory module. */
+void
+dir_init (void)
+{
+  dir_cache = kmem_cache_create ("dir", sizeof (struct dir), NULL);
+  if (dir_cache == NULL)
+    PANIC ("cannot create directory cache");
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -40,7 +53,7 @@ dir_open (struct inode *inode)
 {
    //printf("dir_ope function\n\n");
 
-  struct dir *dir = calloc (1, sizeof *dir);
+  struct dir *dir = kmem_cache_alloc (dir_cache);
   if (inode != NULL && dir != NULL)
   {
     dir->inode = inode;
@@ -50,7 +63,7 @@ dir_open (struct inode *inode)
   else
   {
     inode_close (inode);
-    free (dir);
+    kmem_cache_free (dir_cache, dir);
     return NULL; 
   }
 }
@@ -78,7 +91,7 @@ dir_close (struct dir *dir)
   if (dir != NULL)
   {
     inode_close (dir->inode);
-    free (dir);
+    kmem_cache_free (dir_cache, dir);
   }
 }
 
@@ -7,10 +7,25 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
+/* Panics if FILE, opened by filesys_open() as FILE_NAME, is
+   really a directory.  filesys_open() returns a `struct dir' for
+   a directory, which must be closed with dir_close(), never
+   file_close(). */
+static void
+check_not_dir (struct file *file, const char *file_name)
+{
+  if (inode_is_dir (file_get_inode (file)))
+    {
+      dir_close ((struct dir *) file);
+      PANIC ("%s: is a directory", file_name);
+    }
+}
+
 /* List files in the root directory. */
 void
 fsutil_ls (char **argv UNUSED) 
@@ -42,6 +57,7 @@ fsutil_cat (char **argv)
   file = filesys_open (file_name);
   if (file == NULL)
     PANIC ("%s: open failed", file_name);
+  check_not_dir (file, file_name);
   buffer = palloc_get_page (PAL_ASSERT);
   for (;;) 
   {
@@ -123,6 +139,7 @@ fsutil_extract (char **argv UNUSED)
       dst = filesys_open (file_name);
       if (dst == NULL)
 	PANIC ("%s: open failed", file_name);
+      check_not_dir (dst, file_name);
 
       /* Do copy. */
       while (size > 0)
@@ -184,6 +201,7 @@ fsutil_append (char **argv)
   src = filesys_open (file_name);
   if (src == NULL)
     PANIC ("%s: open failed", file_name);
+  check_not_dir (src, file_name);
   size = file_length (src);
 
   /* Open target block device. */
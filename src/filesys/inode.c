@@ -6,6 +6,7 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 
 
@@ -136,11 +137,32 @@ struct inode_disk* single_to_double_indirect (struct inode_disk *disk_inode)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache of `struct inode's. */
+static struct kmem_cache *inode_cache;
+
+static void inode_ctor (void *);
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
 	list_init (&open_inodes);
+	inode_cache = kmem_cache_create ("inode", sizeof (struct inode),
+	                                 inode_ctor);
+	if (inode_cache == NULL)
+	  PANIC ("cannot create inode cache");
+}
+
+/* Constructs a `struct inode' for inode_cache.  An inode's lock
+   is free again whenever the inode is freed, so it only needs to
+   be initialized once. */
+static void
+inode_ctor (void *inode_)
+{
+  struct inode *inode = inode_;
+
+  lock_init (&inode->lock);
+  lock_set_name (&inode->lock, "inode");
 }
 
 
@@ -265,7 +287,7 @@ inode_open (block_sector_t sector)
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -278,7 +300,6 @@ inode_open (block_sector_t sector)
   block_read (fs_device, inode->sector, &inode->data);
   inode->isdir = inode->data.isdir;
   inode->parent = inode->data.parent;
-  lock_init(&inode->lock);
   return inode;
 }
 
@@ -349,7 +370,7 @@ inode_close (struct inode *inode)
 	      }
 	  }
         }
-        free (inode); 
+        kmem_cache_free (inode_cache, inode);
     }
 }
 
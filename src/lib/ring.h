@@ -0,0 +1,68 @@
+#ifndef __LIB_RING_H
+#define __LIB_RING_H
+
+/* Submission and completion rings for the "ring_enter" system
+   call, which performs a whole batch of file system operations
+   in one trap into the kernel.  Shared between the kernel and
+   user programs.
+
+   A process sets up a `struct ring' in its own memory, zeroed.
+   To queue an operation, it fills in sq[sq_tail % RING_ENTRIES]
+   and then increments sq_tail.  ring_enter() performs queued
+   operations in order, each as if by the corresponding system
+   call, until the submission ring is empty or the completion
+   ring is full.  For each operation it stores a completion, with
+   the submission's USER_DATA and the system call's return
+   value, in cq[cq_tail % RING_ENTRIES] and increments cq_tail,
+   and it increments sq_head.  The process consumes completions
+   from cq_head up to cq_tail, incrementing cq_head.
+
+   The indexes run freely and wrap around only at UINT_MAX, so
+   a ring is empty when its head equals its tail.  A process
+   must not queue more than RING_ENTRIES operations at a time. */
+
+/* Number of entries in each ring.  Must be a power of 2. */
+#define RING_ENTRIES 64
+
+/* Operations. */
+enum ring_op
+  {
+    RING_OP_NOP,                /* Do nothing; result is 0. */
+    RING_OP_OPEN,               /* open (BUF). */
+    RING_OP_CLOSE,              /* close (FD); result is 0. */
+    RING_OP_READ,               /* read (FD, BUF, LEN). */
+    RING_OP_WRITE,              /* write (FD, BUF, LEN). */
+    RING_OP_PREAD,              /* pread (FD, BUF, LEN, OFFSET). */
+    RING_OP_PWRITE              /* pwrite (FD, BUF, LEN, OFFSET). */
+  };
+
+/* A submitted operation. */
+struct ring_sqe
+  {
+    int op;                     /* One of RING_OP_*. */
+    int fd;                     /* File descriptor. */
+    void *buf;                  /* Buffer, or file name to open. */
+    unsigned len;               /* Length of BUF in bytes. */
+    unsigned offset;            /* File offset for pread/pwrite. */
+    unsigned user_data;         /* Copied to the completion. */
+  };
+
+/* A completed operation. */
+struct ring_cqe
+  {
+    unsigned user_data;         /* From the submission. */
+    int result;                 /* Return value of the operation. */
+  };
+
+/* Submission and completion rings. */
+struct ring
+  {
+    unsigned sq_head;           /* Next submission for the kernel. */
+    unsigned sq_tail;           /* Next free submission slot. */
+    unsigned cq_head;           /* Next completion for the process. */
+    unsigned cq_tail;           /* Next free completion slot. */
+    struct ring_sqe sq[RING_ENTRIES];
+    struct ring_cqe cq[RING_ENTRIES];
+  };
+
+#endif /* lib/ring.h */
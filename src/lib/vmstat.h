@@ -0,0 +1,24 @@
+#ifndef __LIB_VMSTAT_H
+#define __LIB_VMSTAT_H
+
+/* Virtual memory statistics for a process, as returned by the
+   "vmstat" system call.  Shared between the kernel and user
+   programs.
+
+   A fault, here, is any time a page of the process had to be
+   brought into memory, whether because the process touched it or
+   because the kernel pinned it for a system call.  A minor fault
+   needs no I/O: the page is zero-filled or maps a frame that is
+   already in memory.  A major fault reads the page from its file
+   or from swap. */
+struct vmstat
+  {
+    unsigned minor_faults;      /* Faults satisfied without I/O. */
+    unsigned major_faults;      /* Faults that read from disk. */
+    unsigned file_pageins;      /* Major faults that read from a file. */
+    unsigned cow_breaks;        /* Writes to copy-on-write pages. */
+    unsigned resident;          /* Pages now in frames of their own. */
+    unsigned swapped;           /* Pages now in swap. */
+  };
+
+#endif /* lib/vmstat.h */
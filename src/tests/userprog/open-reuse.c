@@ -0,0 +1,41 @@
+/* Opens "sample.txt" many times, which must return a different
+   file descriptor each time, then closes one of them and opens
+   the file again, which must return the descriptor just closed,
+   since it is the lowest one free. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define OPEN_CNT 100
+
+void
+test_main (void) 
+{
+  int fds[OPEN_CNT];
+  char buf[sizeof sample - 1];
+  int i, fd;
+
+  for (i = 0; i < OPEN_CNT; i++)
+    {
+      fds[i] = open ("sample.txt");
+      if (fds[i] < 2)
+        fail ("open #%d returned %d", i, fds[i]);
+      if (i > 0 && fds[i] <= fds[i - 1])
+        fail ("open #%d returned %d after %d", i, fds[i], fds[i - 1]);
+    }
+  msg ("open \"sample.txt\" %d times", OPEN_CNT);
+
+  msg ("close \"sample.txt\" #%d", OPEN_CNT / 2);
+  close (fds[OPEN_CNT / 2]);
+
+  CHECK ((fd = open ("sample.txt")) == fds[OPEN_CNT / 2],
+         "open \"sample.txt\" again");
+
+  CHECK (read (fds[OPEN_CNT - 1], buf, sizeof buf) == (int) sizeof buf,
+         "read \"sample.txt\" #%d", OPEN_CNT - 1);
+  if (memcmp (buf, sample, sizeof buf))
+    fail ("read of \"sample.txt\" returned wrong data");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-reuse) begin
+(open-reuse) open "sample.txt" 100 times
+(open-reuse) close "sample.txt" #50
+(open-reuse) open "sample.txt" again
+(open-reuse) read "sample.txt" #99
+(open-reuse) end
+open-reuse: exit(0)
+EOF
+pass;
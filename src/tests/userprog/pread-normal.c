@@ -0,0 +1,31 @@
+/* Reads part of "sample.txt" with pread(), which must not move
+   the file position, then reads from the start with read(). */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[20];
+  int handle, byte_cnt;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  byte_cnt = pread (handle, buf, sizeof buf, 50);
+  if (byte_cnt != sizeof buf)
+    fail ("pread() returned %d instead of %zu", byte_cnt, sizeof buf);
+  compare_bytes (buf, sample + 50, sizeof buf, 50, "sample.txt");
+  msg ("pread \"sample.txt\" at offset 50");
+
+  if (tell (handle) != 0)
+    fail ("pread() moved the file position to %u", tell (handle));
+
+  byte_cnt = read (handle, buf, sizeof buf);
+  if (byte_cnt != sizeof buf)
+    fail ("read() returned %d instead of %zu", byte_cnt, sizeof buf);
+  compare_bytes (buf, sample, sizeof buf, 0, "sample.txt");
+  msg ("read \"sample.txt\" at offset 0");
+}
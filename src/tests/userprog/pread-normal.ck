@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-normal) begin
+(pread-normal) open "sample.txt"
+(pread-normal) pread "sample.txt" at offset 50
+(pread-normal) read "sample.txt" at offset 0
+(pread-normal) end
+pread-normal: exit(0)
+EOF
+pass;
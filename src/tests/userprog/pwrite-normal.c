@@ -0,0 +1,31 @@
+/* Writes "sample.txt" to a new file with pwrite(), back half
+   first, which must not move the file position, then checks the
+   file's contents. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t half = (sizeof sample - 1) / 2;
+  size_t rest = sizeof sample - 1 - half;
+  int handle, byte_cnt;
+
+  CHECK (create ("test.txt", sizeof sample - 1), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  byte_cnt = pwrite (handle, sample + half, rest, half);
+  if (byte_cnt != (int) rest)
+    fail ("pwrite() returned %d instead of %zu", byte_cnt, rest);
+  byte_cnt = pwrite (handle, sample, half, 0);
+  if (byte_cnt != (int) half)
+    fail ("pwrite() returned %d instead of %zu", byte_cnt, half);
+  if (tell (handle) != 0)
+    fail ("pwrite() moved the file position to %u", tell (handle));
+  close (handle);
+
+  check_file ("test.txt", sample, sizeof sample - 1);
+}
@@ -0,0 +1,25 @@
+/* Passes the read system call a buffer whose first bytes are
+   in the last page of the data segment and whose remaining bytes
+   are in the unmapped page that follows it.
+   The process must be terminated with -1 exit code. */
+
+#include <round.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* End of the data segment, from the linker script. */
+extern char end[];
+
+void
+test_main (void) 
+{
+  char *buffer = (char *) ROUND_UP ((uintptr_t) end, 4096) - 16;
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  read (handle, buffer, 123);
+  fail ("should have exited with -1");
+}
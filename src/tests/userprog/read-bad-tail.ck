@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(read-bad-tail) begin
+(read-bad-tail) open "sample.txt"
+read-bad-tail: exit(-1)
+EOF
+pass;
@@ -0,0 +1,75 @@
+/* Opens "sample.txt" with one ring_enter() call, then reads it,
+   reads part of it with pread(), writes a line to the console,
+   and closes it, all with a second ring_enter() call. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct ring ring;
+
+/* Queues an operation in the ring. */
+static void
+submit (int op, int fd, void *buf, unsigned len, unsigned offset,
+        unsigned user_data)
+{
+  struct ring_sqe *sqe = &ring.sq[ring.sq_tail++ % RING_ENTRIES];
+
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->len = len;
+  sqe->offset = offset;
+  sqe->user_data = user_data;
+}
+
+/* Takes the next completion from the ring, which must be for
+   USER_DATA, and returns its result. */
+static int
+complete (unsigned user_data)
+{
+  struct ring_cqe *cqe;
+
+  if (ring.cq_head == ring.cq_tail)
+    fail ("no completion for operation %u", user_data);
+  cqe = &ring.cq[ring.cq_head++ % RING_ENTRIES];
+  if (cqe->user_data != user_data)
+    fail ("completion for operation %u instead of %u",
+          cqe->user_data, user_data);
+  return cqe->result;
+}
+
+void
+test_main (void) 
+{
+  static char line[] = "(ring-normal) hello from the ring\n";
+  char buf[sizeof sample - 1], part[20];
+  int handle, ret;
+
+  submit (RING_OP_OPEN, 0, "sample.txt", 0, 0, 1);
+  CHECK (ring_enter (&ring) == 1, "submit open");
+  CHECK ((handle = complete (1)) > 1, "open \"sample.txt\"");
+
+  submit (RING_OP_READ, handle, buf, sizeof buf, 0, 2);
+  submit (RING_OP_PREAD, handle, part, sizeof part, 50, 3);
+  submit (RING_OP_WRITE, STDOUT_FILENO, line, sizeof line - 1, 0, 4);
+  submit (RING_OP_CLOSE, handle, NULL, 0, 0, 5);
+  CHECK (ring_enter (&ring) == 4, "submit read, pread, write, close");
+  if (ring.sq_head != ring.sq_tail)
+    fail ("submission ring not drained");
+
+  if ((ret = complete (2)) != sizeof buf)
+    fail ("read returned %d instead of %zu", ret, sizeof buf);
+  compare_bytes (buf, sample, sizeof buf, 0, "sample.txt");
+  if ((ret = complete (3)) != sizeof part)
+    fail ("pread returned %d instead of %zu", ret, sizeof part);
+  compare_bytes (part, sample + 50, sizeof part, 50, "sample.txt");
+  if ((ret = complete (4)) != sizeof line - 1)
+    fail ("write returned %d instead of %zu", ret, sizeof line - 1);
+  if ((ret = complete (5)) != 0)
+    fail ("close returned %d", ret);
+  msg ("verified completions");
+}
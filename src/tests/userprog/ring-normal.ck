@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-normal) begin
+(ring-normal) submit open
+(ring-normal) open "sample.txt"
+(ring-normal) submit read, pread, write, close
+(ring-normal) hello from the ring
+(ring-normal) verified completions
+(ring-normal) end
+ring-normal: exit(0)
+EOF
+pass;
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(write-bad-tail) begin
+(write-bad-tail) open "sample.txt"
+write-bad-tail: exit(-1)
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Writes "sample.txt" to a new file in three pieces with one
+   writev(), and a line to the console the same way, then
+   checks the file's contents. */
+
+#include <iovec.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct iovec iov[3];
+  int handle, byte_cnt;
+
+  iov[0].iov_base = "(writev-normal) ";
+  iov[0].iov_len = 16;
+  iov[1].iov_base = "hello, ";
+  iov[1].iov_len = 7;
+  iov[2].iov_base = "world\n";
+  iov[2].iov_len = 6;
+  if (writev (STDOUT_FILENO, iov, 3) != 29)
+    fail ("writev() to console did not write 29 bytes");
+
+  CHECK (create ("test.txt", sizeof sample - 1), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  iov[0].iov_base = sample;
+  iov[0].iov_len = 10;
+  iov[1].iov_base = sample + 10;
+  iov[1].iov_len = 100;
+  iov[2].iov_base = sample + 110;
+  iov[2].iov_len = sizeof sample - 1 - 110;
+  byte_cnt = writev (handle, iov, 3);
+  if (byte_cnt != sizeof sample - 1)
+    fail ("writev() returned %d instead of %zu", byte_cnt, sizeof sample - 1);
+  close (handle);
+
+  check_file ("test.txt", sample, sizeof sample - 1);
+}
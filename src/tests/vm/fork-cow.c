@@ -0,0 +1,66 @@
+/* Forks a child that overwrites its copies of an initialized
+   array, an uninitialized array, and a stack array, and checks
+   that the parent's copies are unaffected.  Also checks that the
+   child inherits the parent's open file at the same position. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 4096)
+
+static char data[SIZE] = {'x'};
+static char bss[SIZE];
+
+static bool
+all (const char *buf, size_t size, char c)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (buf[i] != c)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  char stack[256];
+  char buf[16];
+  int handle;
+  pid_t child;
+
+  memset (data, 'd', sizeof data);
+  memset (stack, 's', sizeof stack);
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (handle, buf, 5) == 5, "read \"sample.txt\"");
+
+  child = fork ();
+  if (child == 0)
+    {
+      /* The child. */
+      memset (data, 'D', sizeof data);
+      memset (bss, 'B', sizeof bss);
+      memset (stack, 'S', sizeof stack);
+      if (!all (data, sizeof data, 'D') || !all (bss, sizeof bss, 'B')
+          || !all (stack, sizeof stack, 'S'))
+        exit (1);
+      if (tell (handle) != 5 || read (handle, buf, 5) != 5
+          || memcmp (buf, sample + 5, 5))
+        exit (2);
+      exit (42);
+    }
+  CHECK (child != PID_ERROR, "fork");
+  CHECK (wait (child) == 42, "wait for child (should return 42)");
+
+  if (!all (data, sizeof data, 'd'))
+    fail ("child's write to initialized data visible in parent");
+  if (!all (bss, sizeof bss, 0))
+    fail ("child's write to uninitialized data visible in parent");
+  if (!all (stack, sizeof stack, 's'))
+    fail ("child's write to stack visible in parent");
+  CHECK (tell (handle) == 5, "parent's file position unchanged");
+}
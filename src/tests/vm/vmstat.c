@@ -0,0 +1,45 @@
+/* Checks that the "vmstat" system call counts the faults taken
+   when a process touches new pages, and the copy-on-write breaks
+   taken by a forked child. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGES 4
+
+static char data[PAGES * 4096] = {'x'};
+static char bss[PAGES * 4096];
+
+void
+test_main (void)
+{
+  struct vmstat before, after;
+  pid_t child;
+  size_t i;
+
+  vmstat (&before);
+  for (i = 0; i < sizeof bss; i += 4096)
+    bss[i] = 1;
+  vmstat (&after);
+  CHECK (after.minor_faults >= before.minor_faults + PAGES,
+         "touching %d zero pages counts %d minor faults", PAGES, PAGES);
+  CHECK (after.resident >= before.resident + PAGES,
+         "touched pages are resident");
+
+  memset (data, 'd', sizeof data);
+  child = fork ();
+  if (child == 0)
+    {
+      /* The child. */
+      vmstat (&before);
+      for (i = 0; i < sizeof data; i += 4096)
+        data[i] = 'D';
+      vmstat (&after);
+      exit (after.cow_breaks - before.cow_breaks);
+    }
+  CHECK (child != PID_ERROR, "fork");
+  CHECK (wait (child) == PAGES,
+         "child breaks %d copy-on-write pages", PAGES);
+}
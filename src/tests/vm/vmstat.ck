@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(vmstat) begin
+(vmstat) touching 4 zero pages counts 4 minor faults
+(vmstat) touched pages are resident
+(vmstat) fork
+(vmstat) child breaks 4 copy-on-write pages
+(vmstat) end
+EOF
+pass;
@@ -19,8 +19,10 @@
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
+#include "threads/memprof.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -37,10 +39,21 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 
 /* Page directory with kernel mappings only */
 uint32_t *init_page_dir;
 
+/* CPUID function 1 feature flag in EDX: page size extensions. */
+#define CPUID_PSE 0x00000008
+
+/* CR4 flag: enable 4 MB pages. */
+#define CR4_PSE 0x00000010
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -127,6 +140,12 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
+#ifdef VM
+  /* Initialize virtual memory. */
+  frame_init ();
+  swap_init ();
+#endif
+
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -150,16 +169,45 @@ bss_init (void)
   memset (&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
-/* Populates the base page directory and page table with the
+/* Returns true if the CPU supports 4 MB pages, according to the
+   PSE feature flag returned by CPUID.  See [IA32-v2a] "CPUID". */
+static bool
+cpu_has_pse (void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return (edx & CPUID_PSE) != 0;
+}
+
+/* Populates the base page directory and page tables with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports it, every 4 MB of RAM is mapped with a
+   single 4 MB page instead of a page table: that saves a page
+   table per 4 MB and, more importantly, lets one TLB entry cover
+   what would otherwise take 1,024.  The 4 MB containing the
+   kernel text, and any partial 4 MB at the end of RAM, are still
+   mapped with 4 kB pages, so that the kernel text can be
+   read-only without making its neighbors read-only too. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  bool pse = cpu_has_pse ();
+
+  if (pse)
+    {
+      /* Enable page size extensions.  See [IA32-v3a] 2.5
+         "Control Registers". */
+      uint32_t cr4;
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4 | CR4_PSE));
+    }
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -171,6 +219,14 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (pse && pte_idx == 0 && page + (1 << PTBITS) <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+          pd[pde_idx] = pde_create_large (vaddr, true);
+          page += (1 << PTBITS) - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
@@ -256,9 +312,23 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-lockstat"))
+        lock_profiling = true;
+      else if (!strcmp (name, "-heapstat"))
+        heap_profiling = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-stk"))
+        stack_page_limit = atoi (value);
+      else if (!strcmp (name, "-vmstat"))
+        page_stats_report = true;
+      else if (!strcmp (name, "-rss-soft"))
+        rss_soft_page_limit = atoi (value);
+      else if (!strcmp (name, "-rss-hard"))
+        rss_hard_page_limit = atoi (value);
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -379,8 +449,16 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -lockstat          Profile lock contention, report at shutdown.\n"
+          "  -heapstat          Profile kernel memory use, report at shutdown.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -stk=COUNT         Limit user stacks to COUNT pages.\n"
+          "  -vmstat            Report page faults when each process exits.\n"
+          "  -rss-soft=COUNT    Evict first from processes above COUNT pages.\n"
+          "  -rss-hard=COUNT    Limit each process to COUNT resident pages.\n"
 #endif
           );
   shutdown_power_off ();
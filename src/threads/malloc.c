@@ -5,8 +5,9 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/memprof.h"
 #include "threads/palloc.h"
-#include "threads/synch.h"
+#include "threads/spinlock.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc()
@@ -32,15 +33,43 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header */
+   the beginning of the allocated block's arena header
+
+   In front of each descriptor's free list sits a "magazine", a
+   small stack of free blocks that belongs to the CPU rather than
+   to the descriptor.  malloc() pops a block from the magazine
+   and free() pushes one onto it, with interrupts turned off but
+   without taking the descriptor's lock.  Only when the magazine
+   is empty or full do we take the lock, to move half a
+   magazine's worth of blocks from or to the free list at once.
+   Blocks in a magazine count as in use as far as their arenas
+   are concerned, so an arena is not given back to the page
+   allocator while any of its blocks is in a magazine.
+
+   Pintos has only one CPU, so each descriptor has just one
+   magazine.  With more CPUs, each would have its own. */
+
+/* Maximum number of blocks in a magazine. */
+#define MAG_ROUNDS 16
+
+/* Magazine. */
+struct magazine
+  {
+    size_t cnt;                         /* Number of blocks. */
+    struct block *rounds[MAG_ROUNDS];   /* Free blocks. */
+  };
 
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
+    size_t mag_size;            /* Capacity of the magazine. */
+    size_t arena_cnt;           /* Number of arenas. */
+    struct magazine mag;        /* The CPU's magazine. */
     struct list free_list;      /* List of free blocks. */
-    struct lock lock;           /* Lock. */
+    struct spinlock lock;       /* Lock. */
+    char name[16];              /* Lock name, for statistics. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -66,6 +95,10 @@ static size_t desc_cnt;         /* Number of descriptors. */
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void *do_malloc (size_t);
+static void *record_alloc (void *, size_t, void *site);
+static bool mag_refill (struct desc *);
+static size_t mag_drain (struct desc *, struct arena *free_arenas[]);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -79,8 +112,15 @@ malloc_init (void)
       ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
       d->block_size = block_size;
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+
+      /* Don't let magazines hold much more than an arena. */
+      d->mag_size = (d->blocks_per_arena < MAG_ROUNDS
+                     ? d->blocks_per_arena : MAG_ROUNDS);
+      d->mag.cnt = 0;
+      d->arena_cnt = 0;
       list_init (&d->free_list);
-      lock_init (&d->lock);
+      snprintf (d->name, sizeof d->name, "malloc %zu", block_size);
+      spinlock_init (&d->lock, d->name);
     }
 }
 
@@ -88,10 +128,19 @@ malloc_init (void)
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) 
+{
+  return record_alloc (do_malloc (size), size, __builtin_return_address (0));
+}
+
+/* Does the work of malloc(), without profiling. */
+static void *
+do_malloc (size_t size) 
 {
   struct desc *d;
+  struct magazine *m;
   struct block *b;
   struct arena *a;
+  enum intr_level old_level;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -119,37 +168,17 @@ malloc (size_t size)
       return a + 1;
     }
 
-  lock_acquire (&d->lock);
-
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
+  /* Get a block from the magazine, refilling it first if it is
+     empty, and return it. */
+  old_level = intr_disable ();
+  m = &d->mag;
+  if (m->cnt == 0 && !mag_refill (d))
     {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
-        }
+      intr_set_level (old_level);
+      return NULL;
     }
-
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
-  lock_release (&d->lock);
+  b = m->rounds[--m->cnt];
+  intr_set_level (old_level);
   return b;
 }
 
@@ -167,7 +196,7 @@ calloc (size_t a, size_t b)
     return NULL;
 
   /* Allocate and zero memory. */
-  p = malloc (size);
+  p = record_alloc (do_malloc (size), size, __builtin_return_address (0));
   if (p != NULL)
     memset (p, 0, size);
 
@@ -201,7 +230,8 @@ realloc (void *old_block, size_t new_size)
     }
   else 
     {
-      void *new_block = malloc (new_size);
+      void *new_block = record_alloc (do_malloc (new_size), new_size,
+                                      __builtin_return_address (0));
       if (old_block != NULL && new_block != NULL)
         {
           size_t old_size = block_size (old_block);
@@ -220,6 +250,9 @@ free (void *p)
 {
   if (p != NULL)
     {
+      if (heap_profiling)
+        memprof_free (MEMPROF_MALLOC, p);
+
       struct block *b = p;
       struct arena *a = block_to_arena (b);
       struct desc *d = a->desc;
@@ -227,32 +260,29 @@ free (void *p)
       if (d != NULL) 
         {
           /* It's a normal block.  We handle it here. */
+          struct magazine *m = &d->mag;
+          struct arena *free_arenas[MAG_ROUNDS];
+          size_t free_arena_cnt = 0;
+          enum intr_level old_level;
+          size_t i;
 
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
           memset (b, 0xcc, d->block_size);
 #endif
   
-          lock_acquire (&d->lock);
-
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
-            {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
-            }
-
-          lock_release (&d->lock);
+          /* Put the block in the magazine, first draining it if
+             it is full. */
+          old_level = intr_disable ();
+          if (m->cnt >= d->mag_size)
+            free_arena_cnt = mag_drain (d, free_arenas);
+          m->rounds[m->cnt++] = b;
+          intr_set_level (old_level);
+
+          /* Give emptied arenas back with interrupts on, so that
+             the page allocator's work isn't done with them off. */
+          for (i = 0; i < free_arena_cnt; i++)
+            palloc_free_page (free_arenas[i]);
         }
       else
         {
@@ -263,6 +293,138 @@ free (void *p)
     }
 }
 
+/* Prints, for each descriptor, how many arenas it has and how
+   many of their blocks are in use.  Blocks in magazines count as
+   free. */
+void
+malloc_print_stats (void)
+{
+  struct desc *d;
+
+  printf ("  malloc arenas:\n");
+  for (d = descs; d < descs + desc_cnt; d++)
+    {
+      enum intr_level old_level = spin_lock_irqsave (&d->lock);
+      size_t arena_cnt = d->arena_cnt;
+      size_t total = arena_cnt * d->blocks_per_arena;
+      size_t free_cnt = list_size (&d->free_list) + d->mag.cnt;
+      spin_unlock_irqrestore (&d->lock, old_level);
+
+      if (arena_cnt > 0)
+        printf ("    %4zu bytes: %zu arenas, %zu of %zu blocks in use "
+                "(%zu%%)\n", d->block_size, arena_cnt, total - free_cnt,
+                total, (total - free_cnt) * 100 / total);
+    }
+}
+
+/* Records that the allocator returned P, of SIZE bytes, to a
+   caller at SITE, if heap profiling is enabled and P is
+   non-null.  Returns P. */
+static void *
+record_alloc (void *p, size_t size, void *site)
+{
+  if (heap_profiling && p != NULL)
+    memprof_alloc (MEMPROF_MALLOC, p, size, site);
+  return p;
+}
+
+/* Moves up to half a magazine of blocks from D's free list into
+   its empty magazine, creating a new arena if the free list is
+   empty.  Returns true if successful, false if no memory is
+   available.  Interrupts must be off. */
+static bool
+mag_refill (struct desc *d)
+{
+  struct magazine *m = &d->mag;
+  size_t batch = (d->mag_size + 1) / 2;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (m->cnt == 0);
+
+  spin_lock (&d->lock);
+
+  /* If the free list is empty, create a new arena. */
+  if (list_empty (&d->free_list))
+    {
+      struct arena *a;
+      size_t i;
+
+      /* Allocate a page. */
+      a = palloc_get_page (0);
+      if (a == NULL) 
+        {
+          spin_unlock (&d->lock);
+          return false; 
+        }
+
+      /* Initialize arena and add its blocks to the free list. */
+      a->magic = ARENA_MAGIC;
+      a->desc = d;
+      a->free_cnt = d->blocks_per_arena;
+      for (i = 0; i < d->blocks_per_arena; i++) 
+        {
+          struct block *b = arena_to_block (a, i);
+          list_push_back (&d->free_list, &b->free_elem);
+        }
+      d->arena_cnt++;
+    }
+
+  /* Take blocks from the free list. */
+  while (m->cnt < batch && !list_empty (&d->free_list))
+    {
+      struct block *b = list_entry (list_pop_front (&d->free_list),
+                                    struct block, free_elem);
+      block_to_arena (b)->free_cnt--;
+      m->rounds[m->cnt++] = b;
+    }
+
+  spin_unlock (&d->lock);
+  return true;
+}
+
+/* Moves half of the blocks in D's full magazine back to its free
+   list.  Arenas that become entirely unused are removed from the
+   free list and stored in FREE_ARENAS, which must have room for
+   MAG_ROUNDS elements, for the caller to free; returns the
+   number stored.  Interrupts must be off. */
+static size_t
+mag_drain (struct desc *d, struct arena *free_arenas[])
+{
+  struct magazine *m = &d->mag;
+  size_t batch = (d->mag_size + 1) / 2;
+  size_t free_arena_cnt = 0;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (m->cnt == d->mag_size);
+
+  spin_lock (&d->lock);
+  while (batch-- > 0)
+    {
+      struct block *b = m->rounds[--m->cnt];
+      struct arena *a = block_to_arena (b);
+
+      /* Add block to free list. */
+      list_push_front (&d->free_list, &b->free_elem);
+
+      /* If the arena is now entirely unused, free it. */
+      if (++a->free_cnt >= d->blocks_per_arena) 
+        {
+          size_t i;
+
+          ASSERT (a->free_cnt == d->blocks_per_arena);
+          for (i = 0; i < d->blocks_per_arena; i++) 
+            {
+              struct block *b = arena_to_block (a, i);
+              list_remove (&b->free_elem);
+            }
+          free_arenas[free_arena_cnt++] = a;
+          d->arena_cnt--;
+        }
+    }
+  spin_unlock (&d->lock);
+  return free_arena_cnt;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
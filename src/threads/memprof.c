@@ -0,0 +1,278 @@
+#include "threads/memprof.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+
+/* Kernel heap profiling.
+
+   When enabled, malloc(), calloc(), realloc(), and the palloc
+   functions report each allocation here with the address it
+   was called from, and each free.  We keep:
+
+      - For each call site, the bytes and blocks it has allocated
+        that are still outstanding, so that a leak shows up as a
+        site whose outstanding bytes only grow.
+
+      - A histogram of request sizes for each allocator.
+
+      - Current and peak bytes outstanding for each allocator,
+        among the allocations recorded.
+
+   To find the call site of a free, outstanding allocations are
+   kept in a fixed-size open-addressing hash table keyed by
+   address.  Like the lock profile, all of this lives in static
+   tables, so profiling never allocates memory itself; whatever
+   does not fit is counted and reported as not recorded.
+
+   Pages that malloc() obtains for its arenas and big blocks are
+   counted both as malloc() blocks, attributed to malloc()'s
+   caller, and as palloc pages, attributed to malloc(). */
+bool heap_profiling;
+
+/* Outstanding allocations for one call site. */
+struct heap_site
+  {
+    void *site;                 /* Caller of the allocator. */
+    enum memprof_kind kind;     /* Allocator called. */
+    size_t cur_bytes;           /* Bytes outstanding. */
+    unsigned cur_cnt;           /* Allocations outstanding. */
+    unsigned alloc_cnt;         /* Total allocations. */
+  };
+
+/* Table of call sites. */
+#define SITE_CNT 64
+static struct heap_site sites[SITE_CNT];
+static size_t site_cnt;
+
+/* An outstanding allocation. */
+struct heap_alloc
+  {
+    void *ptr;                  /* Address, or null if unused. */
+    size_t size;                /* Size in bytes. */
+    struct heap_site *site;     /* Call site. */
+  };
+
+/* Table of outstanding allocations, indexed by hashed address
+   with linear probing. */
+#define ALLOC_CNT 2048
+static struct heap_alloc allocs[ALLOC_CNT];
+
+/* Request size histogram: bucket I counts requests of
+   2**(I - 1) + 1 to 2**I bytes. */
+#define BUCKET_CNT 32
+
+/* Totals for each allocator. */
+struct heap_totals
+  {
+    size_t cur_bytes;           /* Recorded bytes outstanding. */
+    size_t peak_bytes;          /* Maximum of CUR_BYTES. */
+    unsigned alloc_cnt;         /* Allocations. */
+    unsigned free_cnt;          /* Frees. */
+    unsigned histogram[BUCKET_CNT];
+  };
+static struct heap_totals totals[MEMPROF_KIND_CNT];
+static unsigned unrecorded_cnt;   /* Allocations not recorded. */
+static size_t unrecorded_bytes;   /* Bytes in those allocations. */
+
+static const char *kind_names[MEMPROF_KIND_CNT] = {"malloc", "palloc"};
+
+static struct heap_site *site_lookup (enum memprof_kind, void *site);
+static size_t alloc_hash (void *ptr);
+static struct heap_alloc *alloc_lookup (void *ptr, bool insert);
+static void alloc_remove (struct heap_alloc *);
+
+/* Records that the allocator of the given KIND returned PTR, of
+   SIZE bytes, to a caller at SITE. */
+void
+memprof_alloc (enum memprof_kind kind, void *ptr, size_t size, void *site)
+{
+  struct heap_totals *t = &totals[kind];
+  struct heap_site *s;
+  struct heap_alloc *a;
+  enum intr_level old_level;
+  int bucket;
+
+  ASSERT (kind < MEMPROF_KIND_CNT);
+
+  old_level = intr_disable ();
+
+  t->alloc_cnt++;
+  for (bucket = 0; bucket < BUCKET_CNT - 1 && ((size_t) 1 << bucket) < size;
+       bucket++)
+    continue;
+  t->histogram[bucket]++;
+
+  s = site_lookup (kind, site);
+  a = s != NULL ? alloc_lookup (ptr, true) : NULL;
+  if (a != NULL)
+    {
+      a->ptr = ptr;
+      a->size = size;
+      a->site = s;
+      s->cur_bytes += size;
+      s->cur_cnt++;
+      s->alloc_cnt++;
+
+      /* Only recorded allocations count as outstanding, since
+         only their frees can be matched up. */
+      t->cur_bytes += size;
+      if (t->cur_bytes > t->peak_bytes)
+        t->peak_bytes = t->cur_bytes;
+    }
+  else
+    {
+      unrecorded_cnt++;
+      unrecorded_bytes += size;
+    }
+
+  intr_set_level (old_level);
+}
+
+/* Records that PTR, previously returned by the allocator of the
+   given KIND, was freed. */
+void
+memprof_free (enum memprof_kind kind, void *ptr)
+{
+  struct heap_alloc *a;
+  enum intr_level old_level;
+
+  ASSERT (kind < MEMPROF_KIND_CNT);
+
+  old_level = intr_disable ();
+  totals[kind].free_cnt++;
+  a = alloc_lookup (ptr, false);
+  if (a != NULL && a->site->kind == kind)
+    {
+      totals[kind].cur_bytes -= a->size;
+      a->site->cur_bytes -= a->size;
+      a->site->cur_cnt--;
+      alloc_remove (a);
+    }
+  intr_set_level (old_level);
+}
+
+/* Prints the heap profile, if heap profiling is enabled.  Call
+   sites are return addresses; pass them to the `backtrace'
+   utility to translate them into source locations. */
+void
+memprof_print_stats (void)
+{
+  enum memprof_kind kind;
+  struct heap_site *s;
+
+  if (!heap_profiling)
+    return;
+  heap_profiling = false;
+
+  printf ("Heap profile:");
+  if (unrecorded_cnt > 0)
+    printf (" %u allocations (%zu bytes) not recorded",
+            unrecorded_cnt, unrecorded_bytes);
+  printf ("\n");
+  for (kind = 0; kind < MEMPROF_KIND_CNT; kind++)
+    {
+      struct heap_totals *t = &totals[kind];
+      int bucket;
+
+      printf ("  %s: %zu bytes outstanding, %zu at peak, "
+              "%u allocations, %u frees\n",
+              kind_names[kind], t->cur_bytes, t->peak_bytes,
+              t->alloc_cnt, t->free_cnt);
+      printf ("  %s request sizes:", kind_names[kind]);
+      for (bucket = 0; bucket < BUCKET_CNT; bucket++)
+        if (t->histogram[bucket] > 0)
+          printf (" <=%zu:%u", (size_t) 1 << bucket, t->histogram[bucket]);
+      printf ("\n");
+    }
+
+  printf ("  Outstanding by call site:\n");
+  for (s = sites; s < sites + site_cnt; s++)
+    if (s->cur_cnt > 0)
+      printf ("    %s at %p: %zu bytes in %u blocks, %u allocated\n",
+              kind_names[s->kind], s->site, s->cur_bytes, s->cur_cnt,
+              s->alloc_cnt);
+
+  malloc_print_stats ();
+}
+
+/* Returns the entry for allocator KIND called from SITE, creating
+   it if necessary, or a null pointer if the table is full.
+   Interrupts must be off. */
+static struct heap_site *
+site_lookup (enum memprof_kind kind, void *site)
+{
+  struct heap_site *s;
+
+  for (s = sites; s < sites + site_cnt; s++)
+    if (s->site == site && s->kind == kind)
+      return s;
+  if (site_cnt >= SITE_CNT)
+    return NULL;
+
+  s = &sites[site_cnt++];
+  s->site = site;
+  s->kind = kind;
+  return s;
+}
+
+/* Returns the index in `allocs' at which the search for PTR
+   starts. */
+static size_t
+alloc_hash (void *ptr)
+{
+  return ((uintptr_t) ptr >> 4) * 2654435761u % ALLOC_CNT;
+}
+
+/* Returns the entry for outstanding allocation PTR, or a null
+   pointer if there is none.  If INSERT is true, returns instead
+   an unused entry for PTR, or a null pointer if the table is
+   full.  Interrupts must be off. */
+static struct heap_alloc *
+alloc_lookup (void *ptr, bool insert)
+{
+  size_t start = alloc_hash (ptr);
+  size_t i;
+
+  for (i = 0; i < ALLOC_CNT; i++)
+    {
+      struct heap_alloc *a = &allocs[(start + i) % ALLOC_CNT];
+
+      if (a->ptr == (insert ? NULL : ptr))
+        return a;
+      if (a->ptr == NULL)
+        break;
+    }
+  return NULL;
+}
+
+/* Removes entry A from `allocs', moving later entries of the same
+   probe sequence back into the hole so that none of them becomes
+   unreachable.  Interrupts must be off. */
+static void
+alloc_remove (struct heap_alloc *a)
+{
+  size_t hole = a - allocs;
+  size_t i = hole;
+
+  for (;;)
+    {
+      size_t home;
+
+      i = (i + 1) % ALLOC_CNT;
+      if (allocs[i].ptr == NULL)
+        break;
+
+      /* Entry I can move into the hole unless its home slot lies
+         cyclically after the hole, up to I. */
+      home = alloc_hash (allocs[i].ptr);
+      if ((i > hole && (home <= hole || home > i))
+          || (i < hole && home <= hole && home > i))
+        {
+          allocs[hole] = allocs[i];
+          hole = i;
+        }
+    }
+  allocs[hole].ptr = NULL;
+}
@@ -0,0 +1,26 @@
+#ifndef THREADS_MEMPROF_H
+#define THREADS_MEMPROF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Kernel heap profiling.  See memprof.c for details. */
+
+/* Which allocator an allocation came from. */
+enum memprof_kind
+  {
+    MEMPROF_MALLOC,             /* malloc(), calloc(), realloc(). */
+    MEMPROF_PALLOC,             /* palloc_get_page(), _multiple(). */
+    MEMPROF_KIND_CNT
+  };
+
+/* If true, the kernel's allocators record every allocation and
+   free, and memprof_print_stats() reports them at shutdown.
+   Controlled by kernel command-line option "-heapstat". */
+extern bool heap_profiling;
+
+void memprof_alloc (enum memprof_kind, void *, size_t size, void *site);
+void memprof_free (enum memprof_kind, void *);
+void memprof_print_stats (void);
+
+#endif /* threads/memprof.h */
@@ -1,14 +1,15 @@
 #include "threads/palloc.h"
-#include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/memprof.h"
+#include "threads/spinlock.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,22 +24,81 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes */
+   kernel pool, but that's just fine for demonstration purposes
+
+   Each pool is managed as a binary buddy system.  Free memory is
+   kept in blocks of 2**ORDER pages, aligned (relative to the
+   pool's base) to their size, with a free list per order.  A
+   request for N pages takes a block of the smallest order that
+   fits, from the first nonempty free list of that order or
+   above, splitting larger blocks in half as needed, and gives
+   back the pages past N.  Freeing a block merges it with its
+   "buddy", the other half of the block of the next higher order,
+   for as long as the buddy is free too.  Both take time
+   logarithmic in the size of the pool, and runs of free pages
+   don't get chopped up by scattered single-page allocations the
+   way a first-fit scan does.
+
+   Pages may be freed in any grouping, not just the one they were
+   allocated in: a run of pages is freed as the largest aligned
+   blocks that make it up.
+
+   A free block's list element lives in its first page.  The
+   `free_order' array, at the start of the pool, records the order
+   of each free block at the index of its first page, so that
+   finding out whether a buddy is free takes one lookup.
+
+   While the CPU is otherwise idle, the idle thread calls
+   palloc_zero_idle() to take single free pages out of the buddy
+   system, zero them, and keep them on the pool's `zero_list', up
+   to ZERO_PAGES_MAX of them.  A PAL_ZERO request for one page
+   takes a page from that list, if there is one, and skips the
+   memset().  If a pool runs out of memory, its zeroed pages are
+   given back to the buddy system first. */
+
+/* Number of block orders.  The largest block is 2**(ORDER_CNT -
+   1) pages. */
+#define ORDER_CNT 20
+
+/* Maximum number of zeroed pages to keep in each pool. */
+#define ZERO_PAGES_MAX 32
+
+/* Value in `free_order' for a page that does not begin a free
+   block. */
+#define NOT_FREE 0xff
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
+    struct spinlock lock;               /* Mutual exclusion. */
+    struct list free_lists[ORDER_CNT];  /* Free blocks of each order. */
+    uint8_t *free_order;                /* Order of each free block. */
+    struct list zero_list;              /* Zeroed pages. */
+    size_t zero_cnt;                    /* Pages zeroed or being zeroed. */
+    size_t page_cnt;                    /* Number of pages. */
     uint8_t *base;                      /* Base of pool. */
   };
 
+/* A free block. */
+struct free_block
+  {
+    struct list_elem elem;              /* Element in free list. */
+  };
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t alloc_pages (struct pool *, size_t page_cnt);
+static void free_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_block (struct pool *, size_t page_idx, int order);
+static void *get_multiple (enum palloc_flags, size_t page_cnt);
+static void *record_alloc (void *, size_t page_cnt, void *site);
+static bool reclaim_zeroed (struct pool *);
+static bool zero_page (struct pool *);
+static struct free_block *idx_to_block (struct pool *, size_t page_idx);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -69,26 +129,48 @@ palloc_init (size_t user_page_limit)
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
+{
+  return record_alloc (get_multiple (flags, page_cnt), page_cnt,
+                       __builtin_return_address (0));
+}
+
+/* Does the work of palloc_get_multiple(), without profiling. */
+static void *
+get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void *pages;
+  void *pages = NULL;
   size_t page_idx;
+  bool zeroed = false;
+  enum intr_level old_level;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
-
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
+  old_level = spin_lock_irqsave (&pool->lock);
+  if (page_cnt == 1 && (flags & PAL_ZERO) && !list_empty (&pool->zero_list))
+    {
+      /* Take a page that the idle thread has already zeroed. */
+      struct free_block *b = list_entry (list_pop_front (&pool->zero_list),
+                                         struct free_block, elem);
+      pool->zero_cnt--;
+      memset (b, 0, sizeof *b);
+      pages = b;
+      zeroed = true;
+    }
   else
-    pages = NULL;
+    {
+      page_idx = alloc_pages (pool, page_cnt);
+      if (page_idx == SIZE_MAX && reclaim_zeroed (pool))
+        page_idx = alloc_pages (pool, page_cnt);
+      if (page_idx != SIZE_MAX)
+        pages = pool->base + PGSIZE * page_idx;
+    }
+  spin_unlock_irqrestore (&pool->lock, old_level);
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
+      if ((flags & PAL_ZERO) && !zeroed)
         memset (pages, 0, PGSIZE * page_cnt);
     }
   else 
@@ -110,7 +192,21 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 void *
 palloc_get_page (enum palloc_flags flags) 
 {
-  return palloc_get_multiple (flags, 1);
+  return record_alloc (get_multiple (flags, 1), 1,
+                       __builtin_return_address (0));
+}
+
+/* Zeroes a free page in the background, for a later
+   palloc_get_page(PAL_ZERO), if either pool has fewer than
+   ZERO_PAGES_MAX zeroed pages and a page to spare.  Returns true
+   if a page was zeroed, false if there was nothing to do.  Called
+   by the idle thread with interrupts on. */
+bool
+palloc_zero_idle (void)
+{
+  ASSERT (intr_get_level () == INTR_ON);
+
+  return zero_page (&kernel_pool) || zero_page (&user_pool);
 }
 
 /* Frees the PAGE_CNT pages starting at PAGES. */
@@ -119,10 +215,13 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 {
   struct pool *pool;
   size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
     return;
+  if (heap_profiling)
+    memprof_free (MEMPROF_PALLOC, pages);
 
   if (page_from_pool (&kernel_pool, pages))
     pool = &kernel_pool;
@@ -137,8 +236,9 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  old_level = spin_lock_irqsave (&pool->lock);
+  free_pages (pool, page_idx, page_cnt);
+  spin_unlock_irqrestore (&pool->lock, old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -153,20 +253,34 @@ palloc_free_page (void *page)
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's free_order array at its base.
+     Calculate the space needed for it
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  size_t map_pages = DIV_ROUND_UP (page_cnt, PGSIZE);
+  enum intr_level old_level;
+  int order;
+
+  if (map_pages > page_cnt)
+    PANIC ("Not enough memory in %s for free page map.", name);
+  page_cnt -= map_pages;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  spinlock_init (&p->lock, name);
+  for (order = 0; order < ORDER_CNT; order++)
+    list_init (&p->free_lists[order]);
+  list_init (&p->zero_list);
+  p->zero_cnt = 0;
+  p->free_order = base;
+  memset (p->free_order, NOT_FREE, page_cnt);
+  p->page_cnt = page_cnt;
+  p->base = (uint8_t *) base + map_pages * PGSIZE;
+
+  /* Every page starts out free. */
+  old_level = spin_lock_irqsave (&p->lock);
+  free_pages (p, 0, page_cnt);
+  spin_unlock_irqrestore (&p->lock, old_level);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -176,7 +290,171 @@ page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first one, or SIZE_MAX if no run of free pages is
+   large enough.  The caller must hold POOL's lock. */
+static size_t
+alloc_pages (struct pool *p, size_t page_cnt)
+{
+  struct free_block *b;
+  size_t page_idx;
+  int order, want;
+
+  ASSERT (spin_is_locked (&p->lock));
+  ASSERT (page_cnt > 0);
+
+  /* Find the smallest order that holds PAGE_CNT pages. */
+  for (want = 0; ((size_t) 1 << want) < page_cnt; want++)
+    if (want == ORDER_CNT - 1)
+      return SIZE_MAX;
+
+  /* Take the smallest free block that is big enough. */
+  for (order = want; order < ORDER_CNT; order++)
+    if (!list_empty (&p->free_lists[order]))
+      break;
+  if (order == ORDER_CNT)
+    return SIZE_MAX;
+  b = list_entry (list_pop_front (&p->free_lists[order]),
+                  struct free_block, elem);
+  page_idx = pg_no (b) - pg_no (p->base);
+  ASSERT (p->free_order[page_idx] == order);
+  p->free_order[page_idx] = NOT_FREE;
+
+  /* Split it down to the order we want, freeing the upper
+     halves. */
+  while (order > want)
+    {
+      size_t buddy;
+
+      order--;
+      buddy = page_idx + ((size_t) 1 << order);
+      p->free_order[buddy] = order;
+      list_push_front (&p->free_lists[order],
+                       &idx_to_block (p, buddy)->elem);
+    }
+
+  /* Give back the pages that weren't asked for. */
+  free_pages (p, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+  return page_idx;
+}
+
+/* Frees the PAGE_CNT pages starting at index PAGE_IDX in POOL,
+   as the largest aligned blocks that make them up.  The caller
+   must hold POOL's lock. */
+static void
+free_pages (struct pool *p, size_t page_idx, size_t page_cnt)
+{
+  ASSERT (spin_is_locked (&p->lock));
+  ASSERT (page_idx + page_cnt <= p->page_cnt);
+
+  while (page_cnt > 0)
+    {
+      int order = 0;
+
+      while (order + 1 < ORDER_CNT
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      free_block (p, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Frees the block of 2**ORDER pages starting at index PAGE_IDX
+   in POOL, merging it with its buddy for as long as the buddy is
+   free. */
+static void
+free_block (struct pool *p, size_t page_idx, int order)
+{
+  ASSERT (p->free_order[page_idx] == NOT_FREE);
+
+  while (order + 1 < ORDER_CNT)
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+      if (buddy >= p->page_cnt || p->free_order[buddy] != order)
+        break;
+      list_remove (&idx_to_block (p, buddy)->elem);
+      p->free_order[buddy] = NOT_FREE;
+      page_idx &= ~((size_t) 1 << order);
+      order++;
+    }
+  p->free_order[page_idx] = order;
+  list_push_front (&p->free_lists[order], &idx_to_block (p, page_idx)->elem);
+}
+
+/* Returns the free block beginning at index PAGE_IDX in POOL. */
+static struct free_block *
+idx_to_block (struct pool *p, size_t page_idx)
+{
+  ASSERT (page_idx < p->page_cnt);
+  return (struct free_block *) (p->base + page_idx * PGSIZE);
+}
+
+/* Gives all of POOL's zeroed pages back to the buddy system.
+   Returns true if there were any.  The caller must hold POOL's
+   lock. */
+static bool
+reclaim_zeroed (struct pool *p)
+{
+  bool reclaimed = !list_empty (&p->zero_list);
+
+  ASSERT (spin_is_locked (&p->lock));
+
+  while (!list_empty (&p->zero_list))
+    {
+      struct free_block *b = list_entry (list_pop_front (&p->zero_list),
+                                         struct free_block, elem);
+      p->zero_cnt--;
+      free_pages (p, pg_no (b) - pg_no (p->base), 1);
+    }
+  return reclaimed;
+}
+
+/* Zeroes one of POOL's free pages and adds it to its zeroed
+   pages, if it has fewer than ZERO_PAGES_MAX of them.  Returns
+   true if successful, false if POOL has enough zeroed pages or
+   no free pages.  The page is zeroed with POOL's lock released. */
+static bool
+zero_page (struct pool *p)
+{
+  enum intr_level old_level;
+  struct free_block *b;
+  size_t page_idx = SIZE_MAX;
+
+  old_level = spin_lock_irqsave (&p->lock);
+  if (p->zero_cnt < ZERO_PAGES_MAX)
+    {
+      page_idx = alloc_pages (p, 1);
+      if (page_idx != SIZE_MAX)
+        p->zero_cnt++;
+    }
+  spin_unlock_irqrestore (&p->lock, old_level);
+  if (page_idx == SIZE_MAX)
+    return false;
+
+  b = (struct free_block *) (p->base + page_idx * PGSIZE);
+  memset (b, 0, PGSIZE);
+
+  old_level = spin_lock_irqsave (&p->lock);
+  list_push_back (&p->zero_list, &b->elem);
+  spin_unlock_irqrestore (&p->lock, old_level);
+  return true;
+}
+
+/* Records that PAGE_CNT pages at PAGES were allocated for a
+   caller at SITE, if heap profiling is enabled and PAGES is
+   non-null.  Returns PAGES. */
+static void *
+record_alloc (void *pages, size_t page_cnt, void *site)
+{
+  if (heap_profiling && pages != NULL)
+    memprof_alloc (MEMPROF_PALLOC, pages, page_cnt * PGSIZE, site);
+  return pages;
+}
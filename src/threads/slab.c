@@ -0,0 +1,233 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/spinlock.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator for objects of a single type.
+
+   Each cache carves pages ("slabs") into slots of exactly its
+   object size, instead of malloc()'s power-of-2 blocks.  A slab
+   starts with a header holding a stack of free slot indexes.
+   Partly free slabs are kept on a list, and at most one wholly
+   free slab is cached; others go back to the page allocator.
+   An optional constructor runs once per slot when its slab is
+   created, so objects must be freed in their constructed state. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* An object cache. */
+struct kmem_cache
+  {
+    size_t obj_size;            /* Size of each slot in bytes. */
+    size_t objs_per_slab;       /* Number of slots in a slab. */
+    size_t obj_ofs;             /* Offset of first slot in a slab. */
+    void (*ctor) (void *);      /* Constructor, or null. */
+    struct list partial;        /* Slabs with some, not all, slots free. */
+    struct slab *empty;         /* A slab with all slots free, or null. */
+    struct spinlock lock;       /* Lock. */
+    char name[16];              /* Name, for lock statistics. */
+  };
+
+/* Slab header, at the start of each slab's page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in cache's `partial' list. */
+    size_t free_cnt;            /* Number of free slots. */
+    uint16_t free[];            /* Indexes of free slots. */
+  };
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (void *);
+static void *slab_to_obj (struct slab *, size_t idx);
+
+/* Creates and returns a cache of objects of SIZE bytes, named
+   NAME.  If CTOR is non-null, it is called on each object before
+   it is first allocated.  Returns a null pointer if memory is
+   not available.  Caches are never destroyed.
+
+   A cache is only worthwhile for objects of no more than a few
+   hundred bytes; larger objects should come from malloc(). */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, void (*ctor) (void *))
+{
+  struct kmem_cache *c;
+  size_t hdr_size;
+
+  ASSERT (size > 0);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    return NULL;
+
+  /* Each slot needs its size plus a free stack entry. */
+  c->obj_size = ROUND_UP (size, sizeof (void *));
+  c->objs_per_slab = ((PGSIZE - sizeof (struct slab))
+                      / (c->obj_size + sizeof (uint16_t)));
+  hdr_size = sizeof (struct slab) + c->objs_per_slab * sizeof (uint16_t);
+  c->obj_ofs = ROUND_UP (hdr_size, sizeof (void *));
+  if (c->obj_ofs + c->objs_per_slab * c->obj_size > PGSIZE)
+    c->objs_per_slab--;
+  ASSERT (c->objs_per_slab > 0);
+
+  c->ctor = ctor;
+  list_init (&c->partial);
+  c->empty = NULL;
+  strlcpy (c->name, name, sizeof c->name);
+  spinlock_init (&c->lock, c->name);
+  return c;
+}
+
+/* Allocates an object from cache C and returns it.  The object
+   is in its constructed state, if C has a constructor, and
+   otherwise has unspecified contents.  Returns a null pointer if
+   memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  struct slab *s;
+  enum intr_level old_level;
+  void *obj;
+
+  ASSERT (c != NULL);
+
+  old_level = spin_lock_irqsave (&c->lock);
+  if (list_empty (&c->partial))
+    {
+      if (c->empty != NULL)
+        {
+          s = c->empty;
+          c->empty = NULL;
+        }
+      else
+        {
+          /* Create a new slab without the lock held. */
+          spin_unlock_irqrestore (&c->lock, old_level);
+          s = slab_create (c);
+          if (s == NULL)
+            return NULL;
+          old_level = spin_lock_irqsave (&c->lock);
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  /* Take a slot from the first partial slab. */
+  s = list_entry (list_front (&c->partial), struct slab, elem);
+  ASSERT (s->free_cnt > 0);
+  obj = slab_to_obj (s, s->free[--s->free_cnt]);
+  if (s->free_cnt == 0)
+    list_remove (&s->elem);
+  spin_unlock_irqrestore (&c->lock, old_level);
+  return obj;
+}
+
+/* Returns OBJ, which must have been allocated from cache C and
+   be in its constructed state, to C.  Does nothing if OBJ is a
+   null pointer. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj)
+{
+  struct slab *s, *free_slab = NULL;
+  enum intr_level old_level;
+
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (obj);
+  ASSERT (s->cache == c);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     its constructed state has to be preserved. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  old_level = spin_lock_irqsave (&c->lock);
+  ASSERT (s->free_cnt < c->objs_per_slab);
+  s->free[s->free_cnt++] = ((uint8_t *) obj - (uint8_t *) s - c->obj_ofs)
+                           / c->obj_size;
+  if (s->free_cnt == 1 && c->objs_per_slab > 1)
+    {
+      /* Was full, now partial. */
+      list_push_front (&c->partial, &s->elem);
+    }
+  else if (s->free_cnt == c->objs_per_slab)
+    {
+      /* Now empty.  Keep one empty slab around so that a cache
+         whose use hovers around a slab boundary doesn't keep
+         going back to the page allocator. */
+      if (c->objs_per_slab > 1)
+        list_remove (&s->elem);
+      if (c->empty == NULL)
+        c->empty = s;
+      else
+        free_slab = s;
+    }
+  spin_unlock_irqrestore (&c->lock, old_level);
+
+  /* Give the slab back outside the lock, as in free(). */
+  if (free_slab != NULL)
+    palloc_free_page (free_slab);
+}
+
+/* Allocates a new slab for cache C, with every slot free and
+   constructed.  Returns a null pointer if memory is not
+   available.  Called without C's lock held. */
+static struct slab *
+slab_create (struct kmem_cache *c)
+{
+  struct slab *s;
+  size_t i;
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->objs_per_slab;
+  for (i = 0; i < c->objs_per_slab; i++)
+    {
+      /* Hand out the lowest slots first. */
+      s->free[i] = c->objs_per_slab - i - 1;
+      if (c->ctor != NULL)
+        c->ctor (slab_to_obj (s, i));
+    }
+  return s;
+}
+
+/* Returns the slab that object OBJ is inside. */
+static struct slab *
+obj_to_slab (void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid. */
+  ASSERT (s != NULL);
+  ASSERT (s->magic == SLAB_MAGIC);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT (pg_ofs (obj) >= s->cache->obj_ofs);
+  ASSERT ((pg_ofs (obj) - s->cache->obj_ofs) % s->cache->obj_size == 0);
+
+  return s;
+}
+
+/* Returns the IDX'th slot within slab S. */
+static void *
+slab_to_obj (struct slab *s, size_t idx)
+{
+  ASSERT (s != NULL);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (idx < s->cache->objs_per_slab);
+  return (uint8_t *) s + s->cache->obj_ofs + idx * s->cache->obj_size;
+}
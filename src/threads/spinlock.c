@@ -0,0 +1,182 @@
+#include "threads/spinlock.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "threads/synch.h"
+
+/* List of all named spinlocks, for spinlock_print_stats(). */
+static struct list all_spinlocks = LIST_INITIALIZER (all_spinlocks);
+
+static void stats_init (struct spinlock_stats *, const char *name);
+static void stats_acquired (struct spinlock_stats *, bool contended);
+static void stats_released (struct spinlock_stats *);
+
+/* Tells the CPU that we are in a spin-wait loop.  See [IA32-v2b]
+   "PAUSE". */
+static inline void
+cpu_relax (void)
+{
+  asm volatile ("pause" : : : "memory");
+}
+
+/* Returns the CPU's time-stamp counter.  See [IA32-v2b]
+   "RDTSC". */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Initializes LOCK as an unlocked ticket lock named NAME.  If
+   NAME is non-null, the lock's statistics are reported by
+   spinlock_print_stats(), so LOCK must then never be freed. */
+void
+spinlock_init (struct spinlock *lock, const char *name)
+{
+  ASSERT (lock != NULL);
+
+  lock->next = lock->owner = 0;
+  stats_init (&lock->stats, name);
+}
+
+/* Acquires LOCK, spinning until it is available.  Interrupts
+   must be off; see spin_lock_irqsave() for a variant that turns
+   them off. */
+void
+spin_lock (struct spinlock *lock)
+{
+  uint16_t ticket;
+  bool contended = false;
+
+  ASSERT (lock != NULL);
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  ticket = __sync_fetch_and_add (&lock->next, 1);
+  while (lock->owner != ticket)
+    {
+      contended = true;
+      cpu_relax ();
+    }
+  barrier ();
+  stats_acquired (&lock->stats, contended);
+}
+
+/* Acquires LOCK and returns true if it is available, otherwise
+   returns false without spinning.  Interrupts must be off. */
+bool
+spin_try_lock (struct spinlock *lock)
+{
+  uint16_t ticket;
+
+  ASSERT (lock != NULL);
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  ticket = lock->owner;
+  if (!__sync_bool_compare_and_swap (&lock->next, ticket,
+                                     (uint16_t) (ticket + 1)))
+    return false;
+  stats_acquired (&lock->stats, false);
+  return true;
+}
+
+/* Releases LOCK, which must be held by the caller. */
+void
+spin_unlock (struct spinlock *lock)
+{
+  ASSERT (lock != NULL);
+  ASSERT (spin_is_locked (lock));
+
+  stats_released (&lock->stats);
+  barrier ();
+  lock->owner++;
+}
+
+/* Turns off interrupts, acquires LOCK, and returns the previous
+   interrupt level, which should be passed to
+   spin_unlock_irqrestore(). */
+enum intr_level
+spin_lock_irqsave (struct spinlock *lock)
+{
+  enum intr_level old_level = intr_disable ();
+  spin_lock (lock);
+  return old_level;
+}
+
+/* Releases LOCK and restores the interrupt level OLD_LEVEL
+   returned by spin_lock_irqsave(). */
+void
+spin_unlock_irqrestore (struct spinlock *lock, enum intr_level old_level)
+{
+  spin_unlock (lock);
+  intr_set_level (old_level);
+}
+
+/* Returns true if LOCK is held by anyone.  This is mainly useful
+   in assertions. */
+bool
+spin_is_locked (const struct spinlock *lock)
+{
+  return lock->next != lock->owner;
+}
+
+/* Prints statistics for every named spinlock that has been
+   acquired at least once. */
+void
+spinlock_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_spinlocks); e != list_end (&all_spinlocks);
+       e = list_next (e))
+    {
+      struct spinlock_stats *s = list_entry (e, struct spinlock_stats, elem);
+
+      if (s->acquire_cnt == 0)
+        continue;
+      printf ("Spinlock %s: %u acquired, %u contended, "
+              "%"PRIu64" cycles held on average, %"PRIu64" at most\n",
+              s->name, s->acquire_cnt, s->contend_cnt,
+              s->hold_total / s->acquire_cnt, s->hold_max);
+    }
+}
+
+/* Initializes statistics S for a lock named NAME, adding them to
+   the list of all spinlocks if NAME is non-null. */
+static void
+stats_init (struct spinlock_stats *s, const char *name)
+{
+  s->name = name;
+  s->acquire_cnt = s->contend_cnt = 0;
+  s->hold_start = s->hold_total = s->hold_max = 0;
+  if (name != NULL)
+    {
+      enum intr_level old_level = intr_disable ();
+      list_push_back (&all_spinlocks, &s->elem);
+      intr_set_level (old_level);
+    }
+}
+
+/* Records that the lock owning S was just acquired, after
+   spinning if CONTENDED is true.  Called with the lock held. */
+static void
+stats_acquired (struct spinlock_stats *s, bool contended)
+{
+  s->acquire_cnt++;
+  if (contended)
+    s->contend_cnt++;
+  s->hold_start = rdtsc ();
+}
+
+/* Records that the lock owning S is about to be released.
+   Called with the lock held. */
+static void
+stats_released (struct spinlock_stats *s)
+{
+  uint64_t held = rdtsc () - s->hold_start;
+
+  s->hold_total += held;
+  if (held > s->hold_max)
+    s->hold_max = held;
+}
@@ -0,0 +1,64 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+
+/* Spinlocks for short critical sections.
+
+   A `struct lock' is a sleeping lock: acquiring a contended one
+   blocks the thread, and every acquisition goes through the
+   priority donation bookkeeping in synch.c.  That is far too
+   heavy for critical sections that are only a few dozen
+   instructions long, such as the page allocator's bitmap scan or
+   pushing a block onto a malloc free list.  Spinlocks are the
+   lightweight alternative for those.  A `struct spinlock' is a
+   ticket lock: acquirers take a ticket and spin until it is
+   served, so the lock is granted in FIFO order.
+
+   Pintos runs on a single CPU, so the only way to find a
+   spinlock held is for its holder to have been preempted.  To
+   rule that out, a spinlock must always be held with interrupts
+   off.  spin_lock() asserts that the caller has already disabled
+   interrupts; spin_lock_irqsave() disables them, returning the
+   previous level for spin_unlock_irqrestore().  Never sleep
+   while holding a spinlock.
+
+   Each lock records how often it was acquired, how often an
+   acquirer had to spin, and how long (in CPU cycles) it was
+   held.  spinlock_print_stats() prints these for every named
+   lock. */
+
+/* Statistics kept by every spinlock. */
+struct spinlock_stats
+  {
+    const char *name;           /* Name, for statistics. */
+    unsigned acquire_cnt;       /* Number of acquisitions. */
+    unsigned contend_cnt;       /* Acquisitions that had to spin. */
+    uint64_t hold_start;        /* Cycle counter at acquisition. */
+    uint64_t hold_total;        /* Total cycles held. */
+    uint64_t hold_max;          /* Longest hold, in cycles. */
+    struct list_elem elem;      /* Element in list of all spinlocks. */
+  };
+
+/* Ticket spinlock. */
+struct spinlock
+  {
+    volatile uint16_t next;     /* Next ticket to hand out. */
+    volatile uint16_t owner;    /* Ticket now being served. */
+    struct spinlock_stats stats;
+  };
+
+void spinlock_init (struct spinlock *, const char *name);
+void spin_lock (struct spinlock *);
+bool spin_try_lock (struct spinlock *);
+void spin_unlock (struct spinlock *);
+enum intr_level spin_lock_irqsave (struct spinlock *);
+void spin_unlock_irqrestore (struct spinlock *, enum intr_level);
+bool spin_is_locked (const struct spinlock *);
+
+void spinlock_print_stats (void);
+
+#endif /* threads/spinlock.h */
@@ -31,6 +31,41 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Lock profiling.
+
+   When enabled, every lock_acquire() and sema_down() is charged
+   to an entry keyed by the lock's name and the address it was
+   called from, so that the report says not only which lock is
+   hot but also which code path takes it.  Entries live in a
+   fixed table, so they outlive the locks they describe (locks
+   embedded in inodes, for example, come and go). */
+bool lock_profiling;
+
+/* Statistics for one lock name and call site. */
+struct lock_profile
+  {
+    const char *name;           /* Lock name, or null for a semaphore. */
+    void *site;                 /* Caller of lock_acquire()/sema_down(). */
+    unsigned acquire_cnt;       /* Number of acquisitions. */
+    unsigned contend_cnt;       /* Acquisitions that had to wait. */
+    int64_t wait_ticks;         /* Total ticks spent waiting. */
+    int64_t max_wait_ticks;     /* Longest wait. */
+    int64_t hold_ticks;         /* Total ticks held (locks only). */
+    int64_t max_hold_ticks;     /* Longest hold. */
+  };
+
+/* Table of profile entries. */
+#define LOCK_PROFILE_CNT 64
+static struct lock_profile lock_profiles[LOCK_PROFILE_CNT];
+static size_t lock_profile_cnt;         /* Entries in use. */
+static unsigned lock_profile_overflow;  /* Acquisitions not recorded. */
+
+static void sema_wait (struct semaphore *);
+static struct lock_profile *lock_profile_record (const char *name,
+                                                 void *site, bool contended,
+                                                 int64_t start);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -59,6 +94,23 @@ sema_init (struct semaphore *sema, unsigned value)
    thread will probably turn interrupts back on. */
 void
 sema_down (struct semaphore *sema) 
+{
+  if (lock_profiling)
+    {
+      bool contended = sema->value == 0;
+      int64_t start = timer_ticks ();
+
+      sema_wait (sema);
+      lock_profile_record (NULL, __builtin_return_address (0),
+                           contended, start);
+    }
+  else
+    sema_wait (sema);
+}
+
+/* Does the work of sema_down(), without profiling. */
+static void
+sema_wait (struct semaphore *sema) 
 {
   enum intr_level old_level;
 
@@ -68,7 +120,10 @@ sema_down (struct semaphore *sema)
   old_level = intr_disable ();
   while (sema->value == 0) 
     {
-      list_insert_ordered (&sema->waiters, &thread_current ()->elem, priority_compare, NULL);
+      struct thread *cur = thread_current ();
+
+      list_insert_ordered (&sema->waiters, &cur->elem, priority_compare, NULL);
+      cur->sema_waiting = sema;
       thread_block ();
     }
   sema->value--;
@@ -116,8 +171,11 @@ sema_up (struct semaphore *sema)
   old_level = intr_disable ();
   if (!list_empty (&sema->waiters)) 
   {
-    list_sort (&sema->waiters, priority_compare, NULL);
+    /* The waiters stay in priority order even when a waiter
+       receives a donation (see priority_donate()), so the front
+       one has the highest priority. */
     unblocked = list_entry (list_pop_front (&sema->waiters), struct thread, elem);
+    unblocked->sema_waiting = NULL;
     thread_unblock (unblocked);
   if( unblocked->priority > thread_current() ->priority )
         yield_condition = true;
@@ -189,8 +247,22 @@ lock_init (struct lock *lock)
 {
   ASSERT (lock != NULL);
 
+  lock->name = NULL;
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->profile = NULL;
+  lock->hold_start = 0;
+}
+
+/* Sets LOCK's name to NAME, under which the lock profiler
+   reports it.  NAME must remain valid as long as the kernel
+   runs. */
+void
+lock_set_name (struct lock *lock, const char *name)
+{
+  ASSERT (lock != NULL);
+
+  lock->name = name;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -208,28 +280,40 @@ lock_acquire (struct lock *lock)
   struct thread *t = thread_current ();
   struct lock *l;
   int depth = 0;
+  bool contended = false;
+  int64_t start = lock_profiling ? timer_ticks () : 0;
   enum intr_level old_level;
 
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   if (lock->holder != NULL)
   {
+      contended = true;
       t->lock_waiting = lock;
       l = lock;
       
 	  /* For nested priority donation. */
-      while (l && t->priority > l->max_priority
+      while (l && l->holder != NULL && t->priority > l->max_priority
              && depth++ < PRIDON_MAX_DEPTH)
       {
           l->max_priority = t->priority;
+
+          /* Keep the holder's lock list ordered by max_priority,
+             so that priority_update() can just look at its front. */
+          list_remove (&l->elem);
+          list_insert_ordered (&l->holder->locks, &l->elem,
+                               lock_priority_compare, NULL);
+
           priority_donate (l->holder);
           l = l->holder->lock_waiting;
       }
   }
+  intr_set_level (old_level);
 
-  sema_down (&lock->semaphore);
+  sema_wait (&lock->semaphore);
 
   old_level = intr_disable ();
   
@@ -240,6 +324,14 @@ lock_acquire (struct lock *lock)
   lock->holder = t;
   
   intr_set_level (old_level);
+
+  if (lock_profiling)
+    {
+      lock->profile = lock_profile_record (lock->name,
+                                           __builtin_return_address (0),
+                                           contended, start);
+      lock->hold_start = timer_ticks ();
+    }
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -258,7 +350,25 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      enum intr_level old_level = intr_disable ();
+
+      /* Track the lock like lock_acquire() does, so that
+         lock_release() finds it in the holder's lock list. */
+      lock->max_priority = thread_current ()->priority;
+      thread_add_lock (lock);
+      lock->holder = thread_current ();
+      intr_set_level (old_level);
+
+      if (lock_profiling)
+        {
+          int64_t now = timer_ticks ();
+          lock->profile = lock_profile_record (lock->name,
+                                               __builtin_return_address (0),
+                                               false, now);
+          lock->hold_start = now;
+        }
+    }
   return success;
 }
 
@@ -279,6 +389,17 @@ lock_release (struct lock *lock)
 
   old_level = intr_disable ();
 
+  if (lock->profile != NULL)
+    {
+      struct lock_profile *p = lock->profile;
+      int64_t held = timer_ticks () - lock->hold_start;
+
+      p->hold_ticks += held;
+      if (held > p->max_hold_ticks)
+        p->max_hold_ticks = held;
+      lock->profile = NULL;
+    }
+
   thread_remove_lock (lock);
 
   lock->holder = NULL;
@@ -379,9 +500,12 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (lock_held_by_current_thread (lock));
 
   if (!list_empty (&cond->waiters)) {
-	list_sort (&cond->waiters, semaphore_priority_compare, NULL);
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+	/* semaphore_priority_compare() orders by descending priority,
+	   so the "minimum" is the highest-priority waiter. */
+	struct list_elem *e = list_min (&cond->waiters,
+	                                semaphore_priority_compare, NULL);
+	list_remove (e);
+    sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
   }
 }
 
@@ -414,11 +538,83 @@ semaphore_priority_compare (const struct list_elem *a, const struct list_elem *b
   else if (list_empty(waiters_b))
     return true;
 
-  list_sort(waiters_a, priority_compare, NULL);
-  list_sort(waiters_b, priority_compare, NULL);
-
+  /* Each waiter list is kept in priority order by sema_down()
+     and priority_donate(), so its front is its maximum. */
   struct thread *thread_a = list_entry (list_front (waiters_a), struct thread, elem);
   struct thread *thread_b = list_entry (list_front (waiters_b), struct thread, elem);
 
   return thread_a->priority > thread_b->priority;
 }
+
+/* Charges an acquisition of the lock named NAME (null for a
+   semaphore) from call site SITE to its profile entry, creating
+   the entry if needed.  CONTENDED says whether the caller found
+   the lock unavailable, and START is the timer tick at which it
+   began trying.  Returns the entry, or a null pointer if the
+   profile table is full. */
+static struct lock_profile *
+lock_profile_record (const char *name, void *site, bool contended,
+                     int64_t start)
+{
+  struct lock_profile *p;
+  int64_t waited = timer_ticks () - start;
+  enum intr_level old_level = intr_disable ();
+
+  for (p = lock_profiles; p < lock_profiles + lock_profile_cnt; p++)
+    if (p->site == site
+        && (p->name == name
+            || (p->name != NULL && name != NULL && !strcmp (p->name, name))))
+      break;
+  if (p == lock_profiles + lock_profile_cnt)
+    {
+      if (lock_profile_cnt >= LOCK_PROFILE_CNT)
+        {
+          lock_profile_overflow++;
+          intr_set_level (old_level);
+          return NULL;
+        }
+      lock_profile_cnt++;
+      p->name = name;
+      p->site = site;
+    }
+
+  p->acquire_cnt++;
+  if (contended)
+    p->contend_cnt++;
+  p->wait_ticks += waited;
+  if (waited > p->max_wait_ticks)
+    p->max_wait_ticks = waited;
+
+  intr_set_level (old_level);
+  return p;
+}
+
+/* Prints the lock profile, if lock profiling is enabled.  Call
+   sites are return addresses; pass them to the `backtrace'
+   utility to translate them into source locations. */
+void
+lock_print_stats (void)
+{
+  struct lock_profile *p;
+  size_t cnt;
+
+  if (!lock_profiling)
+    return;
+
+  /* printf() takes the console lock, so stop profiling before
+     reporting. */
+  lock_profiling = false;
+  cnt = lock_profile_cnt;
+
+  printf ("Lock profile: %zu call sites", cnt);
+  if (lock_profile_overflow > 0)
+    printf (", %u acquisitions not recorded", lock_profile_overflow);
+  printf ("\n");
+  for (p = lock_profiles; p < lock_profiles + cnt; p++)
+    printf ("  %s at %p: %u acquired, %u contended, "
+            "waited %lld ticks (max %lld), held %lld ticks (max %lld)\n",
+            p->name != NULL ? p->name : "semaphore", p->site,
+            p->acquire_cnt, p->contend_cnt,
+            p->wait_ticks, p->max_wait_ticks,
+            p->hold_ticks, p->max_hold_ticks);
+}
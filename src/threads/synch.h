@@ -3,6 +3,7 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore 
@@ -20,13 +21,19 @@ void sema_self_test (void);
 /* Lock. */
 struct lock 
   {
+    const char *name;           /* Name, for profiling (may be null). */
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
     struct list_elem elem;
     int max_priority;
+
+    /* Owned by the lock profiler in synch.c. */
+    struct lock_profile *profile; /* Entry charged for the current hold. */
+    int64_t hold_start;         /* Timer tick when the hold started. */
   };
 
 void lock_init (struct lock *);
+void lock_set_name (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -46,6 +53,14 @@ void cond_broadcast (struct condition *, struct lock *);
 
 bool semaphore_priority_compare (const struct list_elem *, const struct list_elem *, void *);
 
+/* If true, lock_acquire() and sema_down() record per-call-site
+   contention statistics, printed at shutdown by
+   lock_print_stats().  Controlled by kernel command-line option
+   "-lockstat". */
+extern bool lock_profiling;
+
+void lock_print_stats (void);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -14,6 +14,7 @@
 #include "devices/timer.h"
 #include "filesys/directory.h"
 #ifdef USERPROG
+#include "userprog/fdtable.h"
 #include "userprog/process.h"
 #endif
 
@@ -22,9 +23,22 @@
    of thread.h for details */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running */
-static struct list ready_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running.
+
+   Ready threads are kept in one FIFO list per priority level.
+   Bit P of `nonempty' is set exactly when level P holds at least
+   one thread, so both queueing a thread and finding the
+   highest-priority ready thread take constant time regardless of
+   how many threads are ready.  A burst of thread_create() calls
+   therefore no longer pays for an ordered insertion into one
+   long list. */
+struct ready_queue
+  {
+    struct list levels[PRI_MAX + 1];    /* One FIFO per priority. */
+    uint32_t nonempty[(PRI_MAX + 32) / 32]; /* Nonempty levels. */
+  };
+static struct ready_queue ready_queue;
 
 /* List of processes in THREAD_WAIT state */
 static struct list wait_list;
@@ -75,6 +89,11 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static void ready_queue_init (void);
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static struct thread *ready_queue_pop (void);
+static bool ready_queue_empty (void);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -95,7 +114,8 @@ thread_init (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  lock_set_name (&tid_lock, "tid_lock");
+  ready_queue_init ();
   list_init (&wait_list);
   list_init (&all_list);
 
@@ -274,7 +294,7 @@ thread_unblock (struct thread *t)
   ASSERT (t->status == THREAD_BLOCKED);
 
   // Implement priority scheduling 
-  list_insert_ordered (&ready_list, &t->elem, priority_compare, NULL);
+  ready_queue_push (t);
   t->status = THREAD_READY;
 
   intr_set_level (old_level);
@@ -361,7 +381,7 @@ thread_yield (void)
   old_level = intr_disable ();
   if (cur != idle_thread) {
 	///* Implement priority scheduling *///
-	list_insert_ordered (&ready_list, &cur->elem, priority_compare, NULL);
+	ready_queue_push (cur);
   }
 
   cur->status = THREAD_READY;
@@ -448,12 +468,27 @@ priority_donate (struct thread *t)
   enum intr_level old_level;
   old_level = intr_disable ();
   
-  priority_update (t);
-  
+  /* A ready thread is queued at the level of its old priority,
+     so take it off that level before the priority changes. */
   if (t->status == THREAD_READY)
   {
-	list_remove (&t->elem);
-	list_insert_ordered (&ready_list, &t->elem, priority_compare, NULL);
+	ready_queue_remove (t);
+	priority_update (t);
+	ready_queue_push (t);
+  }
+  else
+  {
+	priority_update (t);
+
+	/* Semaphore waiters are kept in priority order so that
+	   sema_up() can just wake the front one.  Move T to its new
+	   place instead of re-sorting the whole list there. */
+	if (t->status == THREAD_BLOCKED && t->sema_waiting != NULL)
+	{
+	  list_remove (&t->elem);
+	  list_insert_ordered (&t->sema_waiting->waiters, &t->elem,
+	                       priority_compare, NULL);
+	}
   }
   
   intr_set_level (old_level);
@@ -470,9 +505,11 @@ priority_update (struct thread *t)
   int max_priority = t->prev_priority;
   int lock_priority;
 
+  /* T's locks are kept ordered by max_priority: thread_add_lock()
+     inserts in order and lock_acquire() repositions a lock whose
+     max_priority it raises.  So the front lock is the maximum. */
   if (!list_empty (&t->locks))
   {
-    list_sort (&t->locks, lock_priority_compare, NULL);
     lock_priority = list_entry (list_front (&t->locks),
                                   struct lock, elem)->max_priority;
     
@@ -537,6 +574,17 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nothing else wants to run, so zero free pages for
+         palloc_get_page(PAL_ZERO) until another thread becomes
+         ready or there is nothing left to zero.  Then let the
+         other thread run or wait for an interrupt. */
+      intr_enable ();
+      while (ready_queue_empty () && palloc_zero_idle ())
+        continue;
+      intr_disable ();
+      if (!ready_queue_empty ())
+        continue;
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -626,10 +674,16 @@ init_thread (struct thread *t, const char *name, int priority)
   t->prev_priority = priority;
   sema_init(&t->wait_sema, 0);
   list_init (&t->locks);
-  list_init (&t->files);
   list_init (&t->children);
+#ifdef USERPROG
+  t->fd_free = FD_MIN;
+#endif
+#ifdef VM
+  list_init (&t->mappings);
+#endif
   sema_init(&t->wait_sema, 0);
   t->lock_waiting = NULL;
+  t->sema_waiting = NULL;
   t->magic = THREAD_MAGIC;
 
   t->process_status = TASK_READY;
@@ -659,10 +713,90 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
-    return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+  struct thread *t = ready_queue_pop ();
+
+  return t != NULL ? t : idle_thread;
+}
+
+/* Initializes the ready queue to hold no threads. */
+static void
+ready_queue_init (void)
+{
+  size_t i;
+
+  for (i = 0; i <= PRI_MAX; i++)
+    list_init (&ready_queue.levels[i]);
+  memset (ready_queue.nonempty, 0, sizeof ready_queue.nonempty);
+}
+
+/* Appends T to the ready queue level of its current priority.
+   Threads of equal priority are run in FIFO order.
+   Must be called with interrupts off. */
+static void
+ready_queue_push (struct thread *t)
+{
+  int pri = t->priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= pri && pri <= PRI_MAX);
+
+  list_push_back (&ready_queue.levels[pri], &t->elem);
+  ready_queue.nonempty[pri / 32] |= 1u << (pri % 32);
+}
+
+/* Removes ready thread T from the ready queue.  T must still
+   have the priority it was queued with.
+   Must be called with interrupts off. */
+static void
+ready_queue_remove (struct thread *t)
+{
+  int pri = t->priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_queue.levels[pri]))
+    ready_queue.nonempty[pri / 32] &= ~(1u << (pri % 32));
+}
+
+/* Removes and returns the longest-waiting thread of the highest
+   nonempty priority level, or a null pointer if no thread is
+   ready.  Must be called with interrupts off. */
+static struct thread *
+ready_queue_pop (void)
+{
+  int word;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (word = sizeof ready_queue.nonempty / sizeof *ready_queue.nonempty - 1;
+       word >= 0; word--)
+    if (ready_queue.nonempty[word] != 0)
+      {
+        int pri = word * 32 + (31 - __builtin_clz (ready_queue.nonempty[word]));
+        struct list *level = &ready_queue.levels[pri];
+        struct thread *t = list_entry (list_pop_front (level),
+                                       struct thread, elem);
+
+        if (list_empty (level))
+          ready_queue.nonempty[word] &= ~(1u << (pri % 32));
+        return t;
+      }
+  return NULL;
+}
+
+/* Returns true if no thread is ready to run. */
+static bool
+ready_queue_empty (void)
+{
+  size_t word_cnt = sizeof ready_queue.nonempty / sizeof *ready_queue.nonempty;
+  size_t word;
+
+  for (word = 0; word < word_cnt; word++)
+    if (ready_queue.nonempty[word] != 0)
+      return false;
+  return true;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -2,8 +2,10 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
 #include <stdint.h>
+#include <vmstat.h>
 #include "synch.h"
 
 /* States in a thread's life cycle. */
@@ -109,6 +111,18 @@ struct thread
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
 #endif
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct hash *pages;                 /* Supplemental page table. */
+    void *user_esp;                     /* User esp on kernel entry. */
+    struct vmstat vmstat;               /* Fault and residency counts. */
+    size_t rss_soft_limit;              /* Evict first above this. */
+    size_t rss_hard_limit;              /* Never resident above this. */
+
+    /* Owned by vm/mmap.c. */
+    struct list mappings;               /* Memory-mapped files. */
+    int next_mapid;                     /* Next mapping identifier. */
+#endif
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
@@ -122,6 +136,7 @@ struct thread
 
     struct list locks;		/* Locks held by this thread */
     struct lock *lock_waiting;	/* The lock this thread is waiting */
+    struct semaphore *sema_waiting; /* The semaphore this thread is blocked on */
 
     /* For process system calls */
 
@@ -139,8 +154,10 @@ struct thread
     
     struct file* executable;	/* To deny other process to executables */
 
-    /* For file system calls */
-    struct list files;  /* Files list */
+    /* For file system calls.  See userprog/fdtable.h. */
+    struct file_elem **fds;	/* Open files, indexed by descriptor */
+    int fd_cnt;			/* Number of slots in fds */
+    int fd_free;		/* No free descriptor below this one */
 
     struct dir *cwd; /* current working directory of the thread */
   };
@@ -177,8 +194,8 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
-void thread_donate_priority (struct thread *);
-void thread_update_priority (struct thread *);
+void priority_donate (struct thread *);
+void priority_update (struct thread *);
 
 void thread_add_lock (struct lock *);
 void thread_remove_lock (struct lock *);
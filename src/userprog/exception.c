@@ -2,9 +2,13 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/uaccess.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -148,7 +152,31 @@ page_fault (struct intr_frame *f)
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
+
+#ifdef VM
+  /* A fault in the kernel cannot tell us the user stack pointer,
+     so it is saved on every entry from user mode. */
+  if (user)
+    thread_current ()->user_esp = f->esp;
+
+  /* A page of the process's address space that is not resident
+     yet, or a stack access just below the stack.  This may
+     happen in the kernel too, when a system call touches a user
+     buffer. */
+  if (not_present && (page_in (fault_addr) || page_grow_stack (fault_addr)))
+    return;
+
+  /* A write to a page that is shared until it is first written,
+     such as an untouched zero page. */
+  if (!not_present && write && page_copy_on_write (fault_addr))
+    return;
+#endif
   
+  /* A bad user address passed to a system call, accessed through
+     one of the functions in uaccess.c. */
+  if (!user && uaccess_fixup (f))
+    return;
+
   // address is not mapped
   if(not_present) exit(-1);
 
@@ -0,0 +1,142 @@
+#include "userprog/fdtable.h"
+#include <debug.h>
+#include <stddef.h>
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/thread.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+
+/* Number of slots in a table when it is first allocated. */
+#define FD_TABLE_MIN 16
+
+/* Grows the current thread's table so that it has a slot for
+   descriptor FD.  Returns true if successful, false if memory
+   allocation fails. */
+static bool
+grow (int fd)
+{
+  struct thread *t = thread_current ();
+  struct file_elem **fds;
+  int cnt, i;
+
+  if (fd < t->fd_cnt)
+    return true;
+
+  cnt = t->fd_cnt > 0 ? t->fd_cnt : FD_TABLE_MIN;
+  while (cnt <= fd)
+    cnt *= 2;
+  fds = realloc (t->fds, cnt * sizeof *fds);
+  if (fds == NULL)
+    return false;
+  for (i = t->fd_cnt; i < cnt; i++)
+    fds[i] = NULL;
+  t->fds = fds;
+  t->fd_cnt = cnt;
+  return true;
+}
+
+/* Installs FE in the current thread's table under the lowest
+   free descriptor, which is stored in FE->fd and returned.
+   Returns -1 if memory allocation fails. */
+int
+fd_install (struct file_elem *fe)
+{
+  struct thread *t = thread_current ();
+  int fd;
+
+  for (fd = t->fd_free; fd < t->fd_cnt; fd++)
+    if (t->fds[fd] == NULL)
+      break;
+  if (!grow (fd))
+    return -1;
+
+  fe->fd = fd;
+  t->fds[fd] = fe;
+  t->fd_free = fd + 1;
+  return fd;
+}
+
+/* Installs FE in the current thread's table under descriptor
+   FD, which must not be in use, and stores FD in FE->fd.
+   Returns true if successful, false if memory allocation
+   fails. */
+bool
+fd_install_at (struct file_elem *fe, int fd)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (fd >= FD_MIN);
+  ASSERT (fd_lookup (fd) == NULL);
+
+  if (!grow (fd))
+    return false;
+
+  fe->fd = fd;
+  t->fds[fd] = fe;
+  if (fd == t->fd_free)
+    t->fd_free = fd + 1;
+  return true;
+}
+
+/* Returns the current thread's file_elem for descriptor FD, or
+   a null pointer if FD is not open. */
+struct file_elem *
+fd_lookup (int fd)
+{
+  struct thread *t = thread_current ();
+
+  if (fd < FD_MIN || fd >= t->fd_cnt)
+    return NULL;
+  return t->fds[fd];
+}
+
+/* Removes descriptor FD from the current thread's table and
+   returns its file_elem, or a null pointer if FD is not open.
+   The caller is responsible for closing and freeing it. */
+struct file_elem *
+fd_remove (int fd)
+{
+  struct thread *t = thread_current ();
+  struct file_elem *fe = fd_lookup (fd);
+
+  if (fe != NULL)
+    {
+      t->fds[fd] = NULL;
+      if (fd < t->fd_free)
+        t->fd_free = fd;
+    }
+  return fe;
+}
+
+/* Closes every file and directory still open in T's table, under
+   filesys_lock like close(), and frees the table. */
+void
+fd_table_destroy (struct thread *t)
+{
+  int fd;
+
+  if (t->fds == NULL)
+    return;
+
+  lock_acquire (&filesys_lock);
+  for (fd = FD_MIN; fd < t->fd_cnt; fd++)
+    {
+      struct file_elem *fe = t->fds[fd];
+
+      if (fe == NULL)
+        continue;
+      if (fe->isdir)
+        dir_close (fe->dir);
+      else
+        file_close (fe->file);
+      kmem_cache_free (file_elem_cache, fe);
+    }
+  lock_release (&filesys_lock);
+  free (t->fds);
+  t->fds = NULL;
+  t->fd_cnt = 0;
+  t->fd_free = FD_MIN;
+}
@@ -0,0 +1,31 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+
+struct file_elem;
+struct thread;
+
+/* A process's file descriptor table.
+
+   Each process has an array of `struct file_elem' pointers
+   indexed by file descriptor, so looking up a descriptor is a
+   bounds check and an array access no matter how many files
+   the process has open.  The array starts out empty and doubles
+   in size whenever it fills up.  A new descriptor is always the
+   lowest one not in use, as in Unix, so descriptors are reused
+   after close() and the array stays dense.
+
+   Descriptors 0 and 1 are the console and never appear in the
+   table. */
+
+/* Lowest descriptor handed out for an open file. */
+#define FD_MIN 2
+
+int fd_install (struct file_elem *);
+bool fd_install_at (struct file_elem *, int fd);
+struct file_elem *fd_lookup (int fd);
+struct file_elem *fd_remove (int fd);
+void fd_table_destroy (struct thread *);
+
+#endif /* userprog/fdtable.h */
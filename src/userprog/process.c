@@ -6,20 +6,32 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/fdtable.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 
 static thread_func start_process NO_RETURN;
+#ifdef VM
+static thread_func start_fork NO_RETURN;
+static bool fork_files (struct thread *parent);
+#endif
 static bool load (const char *file_name, void (**eip) (void), void **esp);
 void set_args_onto_stack(void **esp, const char *file_name, char *save_ptr);
 struct thread *get_child_by_tid(tid_t tid);
@@ -81,6 +93,150 @@ process_execute (const char *file_name)
   return tid;
 }
 
+#ifdef VM
+/* What start_fork() needs from the parent. */
+struct fork_info
+  {
+    struct thread *parent;      /* Process being forked. */
+    struct intr_frame if_;      /* Its user state at the fork call. */
+  };
+
+/* Starts a new thread running a copy of the current process,
+   which entered the kernel with user state F.  The child's
+   address space shares the parent's frames copy-on-write, and it
+   gets its own copies of the parent's open files, positioned
+   where the parent's are.  The child returns 0 from fork() and
+   the parent its thread id.  Returns TID_ERROR if the child
+   cannot be created. */
+tid_t
+process_fork (const struct intr_frame *f)
+{
+  struct thread *cur = thread_current ();
+  struct fork_info info;
+  tid_t tid;
+
+  info.parent = cur;
+  info.if_ = *f;
+
+  sema_init (&cur->load_sema, 0);
+  tid = thread_create (cur->name, PRI_DEFAULT, start_fork, &info);
+  if (tid == TID_ERROR)
+    return tid;
+  cur->process_status = TASK_STOPPED;
+  sema_down (&cur->load_sema);
+
+  /* Destroy child thread that could not copy us */
+  struct thread *child = get_child_by_tid (TID_ERROR);
+  if (child != NULL)
+  {
+    list_remove (&child->child_elem);
+    palloc_free_page (child);
+    return TID_ERROR;
+  }
+
+  return tid;
+}
+
+/* A thread function that copies the parent's address space and
+   files, then returns to user mode as the child of a fork(). */
+static void
+start_fork (void *info_)
+{
+  struct fork_info *info = info_;
+  struct thread *parent = info->parent;
+  struct thread *cur = thread_current ();
+  struct intr_frame if_ = info->if_;   /* INFO dies with sema_up(). */
+  bool success = false;
+
+  /* Do not allow file IO until the files are copied.  The lock
+     is ours, not the parent's, so that if we fail, process_exit()
+     can take it to close what we copied so far. */
+  lock_acquire (&filesys_lock);
+
+  cur->pagedir = pagedir_create ();
+  if (cur->pagedir == NULL)
+    goto done;
+  process_activate ();
+
+  if (parent->executable != NULL)
+    {
+      cur->executable = file_reopen (parent->executable);
+      if (cur->executable == NULL)
+        goto done;
+      file_deny_write (cur->executable);
+    }
+
+  success = (page_table_create ()
+             && page_table_fork (parent, cur->executable)
+             && fork_files (parent));
+
+ done:
+  lock_release (&filesys_lock);
+  if (!success) {
+	thread_current ()->tid = TID_ERROR;
+	thread_exit ();
+  }
+
+  sema_up (&parent->load_sema);
+
+  /* fork() returns 0 in the child. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Gives the current process a copy of each of PARENT's open
+   files, with the same descriptor and position.  Returns true if
+   successful, false if memory allocation fails. */
+static bool
+fork_files (struct thread *parent)
+{
+  int fd;
+
+  for (fd = FD_MIN; fd < parent->fd_cnt; fd++)
+    {
+      struct file_elem *pfe = parent->fds[fd];
+      struct file_elem *fe;
+
+      if (pfe == NULL)
+        continue;
+      fe = kmem_cache_alloc (file_elem_cache);
+      if (fe == NULL)
+        return false;
+      fe->isdir = pfe->isdir;
+      if (pfe->isdir)
+        {
+          fe->dir = dir_reopen (pfe->dir);
+          if (fe->dir == NULL)
+            {
+              kmem_cache_free (file_elem_cache, fe);
+              return false;
+            }
+        }
+      else
+        {
+          fe->file = file_reopen (pfe->file);
+          if (fe->file == NULL)
+            {
+              kmem_cache_free (file_elem_cache, fe);
+              return false;
+            }
+          file_seek (fe->file, file_tell (pfe->file));
+        }
+      if (!fd_install_at (fe, fd))
+        {
+          if (fe->isdir)
+            dir_close (fe->dir);
+          else
+            file_close (fe->file);
+          kmem_cache_free (file_elem_cache, fe);
+          return false;
+        }
+    }
+  return true;
+}
+#endif
+
 void
 set_args_onto_stack(void **esp, const char *file_name, char *save_ptr)
 {
@@ -257,6 +413,13 @@ process_exit (void)
     }
   }
 
+  /* A fault in the kernel on a bad user pointer exits without
+     unwinding, possibly while holding filesys_lock, which
+     fd_table_destroy() and mmap_unmap_all() acquire below. */
+  if (lock_held_by_current_thread (&filesys_lock))
+    lock_release (&filesys_lock);
+
+  fd_table_destroy (cur);
   if(cur->cwd) dir_close(cur->cwd);
 
   cur->parent->process_status = TASK_RUNNING;
@@ -267,6 +430,11 @@ process_exit (void)
 
   pd = cur->pagedir;
 
+#ifdef VM
+  mmap_unmap_all ();
+  page_table_destroy ();
+#endif
+
   if (pd != NULL) 
     {
       /* Correct ordering here is crucial.  We must set
@@ -387,6 +555,10 @@ load (const char *file_name, void (**eip) (void), void **esp)
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
+#ifdef VM
+  if (!page_table_create ())
+    goto done;
+#endif
 
   char *save_ptr;
   file_name = strtok_r (file_name, " ", &save_ptr);
@@ -399,6 +571,13 @@ load (const char *file_name, void (**eip) (void), void **esp)
       printf ("load: %s: open failed\n", file_name);
       goto done; 
     }
+  if (inode_is_dir (file_get_inode (file)))
+    {
+      /* filesys_open() returned a `struct dir'. */
+      dir_close ((struct dir *) file);
+      printf ("load: %s: is a directory\n", file_name);
+      goto done;
+    }
   
   /* To prevent write operations of file's underlying inode
      until file_allow_write() is called or file is closed. */
@@ -495,7 +674,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -554,6 +735,10 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With virtual memory, the pages are only recorded in the
+   supplemental page table here, and each one is read in by the
+   page fault handler when the process first touches it.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
@@ -573,6 +758,12 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      /* Record where the page comes from. */
+      if (!page_alloc_file (upage, file, ofs, page_read_bytes, writable))
+        return false;
+      ofs += page_read_bytes;
+#else
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
@@ -592,6 +783,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           palloc_free_page (kpage);
           return false; 
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
@@ -606,9 +798,19 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 static bool
 setup_stack (void **esp, const char *file_name, char *save_ptr){
   
-  uint8_t *kpage;
   bool success = false;
 
+#ifdef VM
+  /* The stack is an ordinary zero page, so that it can be evicted
+     like any other. */
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
+  success = page_alloc_zero (upage, true) && page_in (upage);
+  if (!success)
+    return success;
+  *esp = PHYS_BASE;
+#else
+  uint8_t *kpage;
+
   kpage = palloc_get_page (PAL_USER | PAL_ZERO);
   if (kpage != NULL) 
     {
@@ -621,12 +823,14 @@ setup_stack (void **esp, const char *file_name, char *save_ptr){
 	    return success;
 	  }
     }
+#endif
 
   set_args_onto_stack(esp, file_name, save_ptr);
 
   return success;
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -646,3 +850,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
@@ -1,6 +1,7 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include "threads/interrupt.h"
 #include "threads/thread.h"
 
 struct file_elem
@@ -9,10 +10,15 @@ struct file_elem
   bool isdir;				// is directory
   struct file *file;			// pointer to file
   struct dir *dir; 			// pointer to dir
-  struct list_elem thread_elem;		// list element for thread's 'files' list
 };
 
+/* Cache of `struct file_elem's, created by syscall_init(). */
+extern struct kmem_cache *file_elem_cache;
+
 tid_t process_execute (const char *file_name);
+#ifdef VM
+tid_t process_fork (const struct intr_frame *);
+#endif
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
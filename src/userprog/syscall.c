@@ -1,11 +1,17 @@
 #include "userprog/syscall.h"
+#include <iovec.h>
+#include <limits.h>
+#include <ring.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/directory.h"
@@ -13,11 +19,23 @@
 #include "threads/synch.h"
 #include "devices/input.h"
 #include "devices/block.h"
+#include "userprog/fdtable.h"
 #include "userprog/process.h"
+#include "userprog/pagedir.h"
+#include "userprog/uaccess.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#endif
 
 static void syscall_handler (struct intr_frame *);
 
+struct kmem_cache *file_elem_cache;
+struct lock filesys_lock;
+
 typedef int pid_t;
+typedef int mapid_t;
 
 // Process System Calls 
 void halt (void) NO_RETURN;
@@ -35,14 +53,26 @@ int write (int fd, const void *buffer, unsigned length);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int ring_enter (struct ring *ring);
+
+#ifdef VM
+// Memory Mapping System Calls
+mapid_t mmap (int fd, void *addr);
+void munmap (mapid_t mapping);
+
+pid_t sys_fork (struct intr_frame *f);
+void vmstat (struct vmstat *stats);
+#endif
 
 void check_valid_address(void *address);  
-struct file_elem * find_file_elem(int fd);
-int alloc_fd(void);
 
 bool chdir(const char *);
 bool mkdir(const char *);
-bool readdir(int, const char *);
+bool readdir(int, char *);
 bool isdir(int);
 bool inumber(int);
 
@@ -51,6 +81,10 @@ syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
   lock_init(&filesys_lock);
+  lock_set_name(&filesys_lock, "filesys_lock");
+  file_elem_cache = kmem_cache_create("file_elem", sizeof (struct file_elem),
+                                      NULL);
+  if(!file_elem_cache) PANIC("cannot create file_elem cache");
 }
 
 
@@ -59,20 +93,100 @@ syscall_init (void)
 void check_valid_address(void *address)  
 {
   struct thread *t = thread_current();
-  if(!address || !is_user_vaddr(address) || pagedir_get_page (t->pagedir, address) == NULL) exit(-1);
+  if(!address || !is_user_vaddr(address)) exit(-1);
+#ifdef VM
+  /* The page may be part of the address space without being
+     resident yet, or be the next page of a growing stack. */
+  if(page_lookup(address) != NULL || page_grow_stack(address)) return;
+#endif
+  if(pagedir_get_page (t->pagedir, address) == NULL) exit(-1);
   return;
 }
 
+/* check every page of the SIZE bytes at BUFFER like
+   check_valid_address(), and without VM also that each page is
+   writable if WILL_WRITE, so that the kernel cannot fault on the
+   buffer while it holds filesys_lock.
+   if any check fails, call exit(-1) */
+static void
+check_valid_buffer (const void *buffer, unsigned size, bool will_write)
+{
+  const uint8_t *p = buffer;
+  uintptr_t last = (uintptr_t) buffer + (size > 0 ? size - 1 : 0);
+
+  if(last < (uintptr_t) buffer || !is_user_vaddr((void *) last)) exit(-1);
+  for(;;)
+  {
+    check_valid_address((void *) p);
+#ifndef VM
+    /* With VM, page_pin_range() checks writability instead. */
+    if(will_write && !pagedir_is_writable(thread_current()->pagedir, p))
+      exit(-1);
+#else
+    (void) will_write;
+#endif
+    if(pg_round_down(p) == pg_round_down((void *) last)) break;
+    p = (const uint8_t *) pg_round_down(p) + PGSIZE;
+  }
+}
+
+
+/* Number of arguments taken by each system call. */
+static const int syscall_argc[] =
+  {
+    [SYS_HALT] = 0, [SYS_EXIT] = 1, [SYS_EXEC] = 1, [SYS_WAIT] = 1,
+    [SYS_CREATE] = 2, [SYS_REMOVE] = 1, [SYS_OPEN] = 1,
+    [SYS_FILESIZE] = 1, [SYS_READ] = 3, [SYS_WRITE] = 3,
+    [SYS_SEEK] = 2, [SYS_TELL] = 1, [SYS_CLOSE] = 1,
+    [SYS_MMAP] = 2, [SYS_MUNMAP] = 1,
+    [SYS_CHDIR] = 1, [SYS_MKDIR] = 1, [SYS_READDIR] = 2,
+    [SYS_ISDIR] = 1, [SYS_INUMBER] = 1,
+    [SYS_FORK] = 0, [SYS_VMSTAT] = 1,
+    [SYS_READV] = 3, [SYS_WRITEV] = 3, [SYS_PREAD] = 4, [SYS_PWRITE] = 4,
+    [SYS_RING_ENTER] = 1,
+  };
+
+/* Copies the string at user address USTR into a new page and
+   returns it, or exits if USTR is not a valid string shorter
+   than a page.  The caller must free the page with
+   palloc_free_page(). */
+static char *
+copy_in_string (const char *ustr)
+{
+  char *kstr = palloc_get_page (0);
+  int len;
+
+  if(kstr == NULL) exit(-1);
+  len = strncpy_from_user(kstr, ustr, PGSIZE);
+  if(len < 0 || len == PGSIZE)
+  {
+    palloc_free_page(kstr);
+    exit(-1);
+  }
+  return kstr;
+}
 
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+syscall_handler (struct intr_frame *f) 
 {
-  int nsyscall, ret;
+  int nsyscall, ret = 0;
+  int arg[4];
   int *esp = (int *)f->esp;
-
-  //check esp is valid>
-  check_valid_address(esp);
-  nsyscall = *esp;
+  char *kstr;
+
+#ifdef VM
+  /* Saved for stack growth on faults in the kernel. */
+  thread_current()->user_esp = esp;
+#endif
+
+  /* Fetch the system call number, then its arguments.  A bad
+     stack pointer makes the copy fail instead of faulting. */
+  if(copy_from_user(&nsyscall, esp, sizeof nsyscall) != 0) exit(-1);
+  if(nsyscall < 0
+     || nsyscall >= (int) (sizeof syscall_argc / sizeof *syscall_argc))
+    exit(-1);
+  if(copy_from_user(arg, esp+1, syscall_argc[nsyscall] * sizeof *arg) != 0)
+    exit(-1);
 
   switch(nsyscall)
   {
@@ -80,81 +194,98 @@ syscall_handler (struct intr_frame *f UNUSED)
       halt();
       break;
     case SYS_EXIT:
-      check_valid_address((int *)(esp+1));
-      exit(*(int *)(esp+1));
+      exit(arg[0]);
       break;
     case SYS_EXEC:
-      check_valid_address((char *)*(esp+1));
-      ret = exec((char *)*(esp+1));
+      kstr = copy_in_string((const char *)arg[0]);
+      ret = exec(kstr);
+      palloc_free_page(kstr);
       break;
     case SYS_WAIT:
-      check_valid_address((pid_t *)(esp+1));
-      ret = wait(*(esp+1));
+      ret = wait(arg[0]);
       break;	
 
     case SYS_CREATE:
-      check_valid_address((char *)*(esp+1));
-      check_valid_address((unsigned *)(esp+2));
-      ret = create((char *)*(esp+1), *(esp+2));
+      kstr = copy_in_string((const char *)arg[0]);
+      ret = create(kstr, arg[1]);
+      palloc_free_page(kstr);
       break;
     case SYS_REMOVE:
-      check_valid_address((char *)*(esp+1));
-      ret = remove((char *)*(esp+1));
+      kstr = copy_in_string((const char *)arg[0]);
+      ret = remove(kstr);
+      palloc_free_page(kstr);
       break;
     case SYS_OPEN:
-      check_valid_address((char *)*(esp+1));
-      ret = open((char *)*(esp+1));
+      kstr = copy_in_string((const char *)arg[0]);
+      ret = open(kstr);
+      palloc_free_page(kstr);
       break;
     case SYS_FILESIZE:
-      check_valid_address((int *)(esp+1));
-      ret = filesize(*(esp+1));
+      ret = filesize(arg[0]);
       break;
     case SYS_READ:
-      check_valid_address((int *)(esp+1));
-      check_valid_address((char *)*(esp+2));
-      check_valid_address((unsigned *)(esp+3));
-      ret = read(*(esp+1), (char *)*(esp+2), *(esp+3));
+      ret = read(arg[0], (char *)arg[1], arg[2]);
       break;
     case SYS_WRITE:
-      check_valid_address((int *)(esp+1));
-      check_valid_address((char *)*(esp+2));
-      check_valid_address((unsigned *)(esp+3));
-      ret = write(*(esp+1), (char *)*(esp+2), *(esp+3));
+      ret = write(arg[0], (char *)arg[1], arg[2]);
       break;
     case SYS_SEEK:
-      check_valid_address((int *)(esp+1));
-      check_valid_address((unsigned *)(esp+2));
-      seek(*(esp+1), *(esp+2));
+      seek(arg[0], arg[1]);
       break;
     case SYS_TELL:
-      check_valid_address((int *)(esp+1));
-      ret = tell(*(esp+1));
+      ret = tell(arg[0]);
       break;
     case SYS_CLOSE:
-      check_valid_address((int *)(esp+1));
-      close(*(esp+1));
+      close(arg[0]);
+      break;
+    case SYS_READV:
+      ret = readv(arg[0], (const struct iovec *)arg[1], arg[2]);
+      break;
+    case SYS_WRITEV:
+      ret = writev(arg[0], (const struct iovec *)arg[1], arg[2]);
+      break;
+    case SYS_PREAD:
+      ret = pread(arg[0], (char *)arg[1], arg[2], arg[3]);
+      break;
+    case SYS_PWRITE:
+      ret = pwrite(arg[0], (char *)arg[1], arg[2], arg[3]);
+      break;
+    case SYS_RING_ENTER:
+      ret = ring_enter((struct ring *)arg[0]);
       break;
     case SYS_CHDIR:
-      check_valid_address((char *)*(esp+1));
-      ret = chdir((char *)*(esp+1));
+      kstr = copy_in_string((const char *)arg[0]);
+      ret = chdir(kstr);
+      palloc_free_page(kstr);
       break;
     case SYS_MKDIR:
-      check_valid_address((char *)*(esp+1));
-      ret = mkdir((char *)*(esp+1));
+      kstr = copy_in_string((const char *)arg[0]);
+      ret = mkdir(kstr);
+      palloc_free_page(kstr);
       break;
     case SYS_READDIR:
-      check_valid_address((int *)(esp+1));
-      check_valid_address((char *)*(esp+2));
-      ret = readdir((int *)(esp+1), (char *)*(esp+2));
+      ret = readdir(arg[0], (char *)arg[1]);
       break;
     case SYS_ISDIR:
-      check_valid_address((int *)(esp+1));
-      ret = isdir((int *)(esp+1));
+      ret = isdir(arg[0]);
       break;
     case SYS_INUMBER:
-      check_valid_address((int *)(esp+1));
-      ret = inumber((int *)(esp+1));
+      ret = inumber(arg[0]);
+      break;
+#ifdef VM
+    case SYS_MMAP:
+      ret = mmap(arg[0], (void *)arg[1]);
+      break;
+    case SYS_MUNMAP:
+      munmap(arg[0]);
       break;
+    case SYS_FORK:
+      ret = sys_fork(f);
+      break;
+    case SYS_VMSTAT:
+      vmstat((struct vmstat *)arg[0]);
+      break;
+#endif
     default:
       exit(-1);
       break;
@@ -176,6 +307,10 @@ void exit (int status)
   struct thread *t = thread_current();
   t->exit_status = status;
   printf ("%s: exit(%d)\n",t->name,status);
+#ifdef VM
+  if (page_stats_report)
+    page_print_stats ();
+#endif
   thread_exit ();
 }
 
@@ -183,7 +318,6 @@ pid_t exec (const char *file)
 {
   //printf("userprog/syscall.c	exec\n");  
   pid_t pid;
-  check_valid_address(file);
   lock_acquire (&filesys_lock);  /* Do not allow file IO until process is loaded */
   pid = process_execute (file);
   lock_release (&filesys_lock);
@@ -198,65 +332,80 @@ int wait (pid_t pid)
 
 
 
+#ifdef VM
+/* fork system call, returns the child's pid in the parent and 0
+   in the child, or -1 if the child could not be created */
+pid_t sys_fork (struct intr_frame *f)
+{
+  return process_fork (f);
+}
+
+/* vmstat system call, copies the process's virtual memory
+   statistics to stats */
+void vmstat (struct vmstat *stats)
+{
+  struct vmstat s;
+
+  lock_acquire (&frame_lock);  /* Counters change under frame_lock */
+  s = thread_current()->vmstat;
+  lock_release (&frame_lock);
+  if(copy_to_user(stats, &s, sizeof s) != 0) exit(-1);
+}
+#endif
+
+
+
 /**** File System Calls ****/
 
 /* write system call,
    returns the number of bytes which are actually written */
 int write (int fd, const void *buffer, unsigned length)
 {
+  struct file_elem *fe = NULL;
   int written = 0;
+
+  /* Check the descriptor before pinning the buffer, so that
+     exiting on a bad one does not leave the buffer pinned. */
   if(fd == 0) exit(-1);// write to input (error)
-  else if(fd == 1)  // write to console
+  if(fd != 1)
   {
+    fe = fd_lookup(fd);
+    if(fe==NULL) exit(-1);
+  }
+  check_valid_buffer(buffer, length, false);
+#ifdef VM
+  /* Pin the buffer before taking any lock; see page_pin_range(). */
+  if(!page_pin_range(buffer, length, false)) exit(-1);
+#endif
+
+  if(fd == 1)  // write to console
+  {
+    unsigned left = length;
+
     lock_acquire(&filesys_lock);
-    if(length < 512)
-    {
-      putbuf((char *)buffer, length);
-      written = length;
-    } else
+    while(left>512)
     {
-      while(length>512)
-      {
-        putbuf((char *)(buffer+written), 512);
-	length -= 512;
-	written += 512;
-      }
-      putbuf((char *)(buffer+written), length);
-      written += length;
+      putbuf((char *)(buffer+written), 512);
+      left -= 512;
+      written += 512;
     }
+    putbuf((char *)(buffer+written), left);
+    written += left;
     lock_release(&filesys_lock);
   } else  // write to a file
   {
-    struct file_elem *fe = find_file_elem(fd);
-    if(fe==NULL) exit(-1);
-    else
-    {
-      struct file *f = fe->file;
-      lock_acquire(&filesys_lock);
-      written = file_write(f, buffer, length);
-      lock_release(&filesys_lock);
-    }
+    lock_acquire(&filesys_lock);
+    written = file_write(fe->file, buffer, length);
+    lock_release(&filesys_lock);
   }
 
+#ifdef VM
+  page_unpin_range(buffer, length);
+#endif
   return written;
 }
 
 
-/* find a file_elem by fd */
-struct file_elem * find_file_elem(int fd)
-{
-  struct list_elem *e;
-  struct thread *t = thread_current();
-
-  for(e = list_begin (&t->files); e != list_end (&t->files); e = list_next (e))
-  {
-    struct file_elem *fe = list_entry (e, struct file_elem, thread_elem);
-    if (fe->fd == fd) return fe;
-  }
-  return NULL;
-}
-
-
 /* create system call, if succeeds, returns true */
 bool create (const char *file, unsigned initial_size)
 {
@@ -303,47 +452,44 @@ int open (const char *file)
 
   if(!f) return -1;
 
-  fe = (struct file_elem *)malloc(sizeof(struct file_elem));
+  fe = kmem_cache_alloc(file_elem_cache);
 
   if(!fe) // fail to allocate memory
   {
-    file_close(f);
+    if(inode_is_dir(file_get_inode(f))) dir_close((struct dir *)f);
+    else file_close(f);
     return -1; 
   }
 
-  lock_acquire(&filesys_lock);
-
   if(inode_is_dir(file_get_inode(f)))
   {
     fe->dir = (struct dir *)f;
     fe->isdir = true;
-    fe->fd = alloc_fd();
-    list_push_back(&thread_current()->files, &fe->thread_elem);
   }
   else
   {
     fe->file = f;
     fe->isdir = false;
-    fe->fd = alloc_fd();
-    list_push_back(&thread_current()->files, &fe->thread_elem);
   }
-  lock_release(&filesys_lock);
+
+  if(fd_install(fe) < 0) // fail to grow the fd table
+  {
+    lock_acquire(&filesys_lock);
+    if(fe->isdir) dir_close(fe->dir);
+    else file_close(fe->file);
+    lock_release(&filesys_lock);
+    kmem_cache_free(file_elem_cache, fe);
+    return -1;
+  }
 
   return fe->fd;
 }
 
 
-/* returns allocated fd value */
-int alloc_fd(void)
-{
-  static int fd = 2;
-  return fd++;
-}
-
 /* returns file size */
 int filesize (int fd)
 {
-  struct file_elem *fe = find_file_elem(fd);
+  struct file_elem *fe = fd_lookup(fd);
   if(!fe) exit(-1);
   return file_length(fe->file);
 }
@@ -357,7 +503,11 @@ int read (int fd, void *buffer, unsigned length)
   struct file_elem *fe;
   unsigned i;
 
-  if(!is_user_vaddr(buffer)||(!is_user_vaddr(buffer+length))) return -1; // buffer is not in user virtual address
+  check_valid_buffer(buffer, length, true);
+#ifdef VM
+  /* Pin the buffer before taking any lock; see page_pin_range(). */
+  if(!page_pin_range(buffer, length, true)) exit(-1);
+#endif
   
   if(fd == 0)  //stdin
   {
@@ -366,27 +516,311 @@ int read (int fd, void *buffer, unsigned length)
       *(uint8_t *)(buffer + i) = input_getc();
     }
     ret = length;
-  } else if(fd == 1) return -1; // stdout
+  } else if(fd == 1) ret = -1; // stdout
   else
   {
     lock_acquire(&filesys_lock);
-    fe = find_file_elem(fd);
-    if(!fe)
-    { 
-      lock_release(&filesys_lock);
-      return -1;
+    fe = fd_lookup(fd);
+    if(!fe) ret = -1;
+    else ret = file_read(fe->file, buffer, length);
+    lock_release(&filesys_lock);
+  }
+
+#ifdef VM
+  page_unpin_range(buffer, length);
+#endif
+  return ret;
+}
+
+/* Copies IOVCNT iovecs from user address UIOV into IOV and
+   checks every page of every buffer they describe, for writing
+   into it if WILL_WRITE.  With VM, also pins all of the buffers,
+   so that the whole transfer can then be done under one
+   acquisition of filesys_lock; iov_release() unpins them.
+   Returns the total length of the buffers.  Exits if any check
+   fails. */
+static size_t
+iov_prepare (struct iovec *iov, const struct iovec *uiov, int iovcnt,
+             bool will_write)
+{
+  size_t total = 0;
+  int i;
+
+  if(copy_from_user(iov, uiov, iovcnt * sizeof *iov) != 0) exit(-1);
+  for(i = 0; i < iovcnt; i++)
+  {
+    char *base = iov[i].iov_base;
+    size_t len = iov[i].iov_len;
+
+    if(len == 0) continue;
+    if(len > INT_MAX - total) exit(-1); // total would not fit the result
+    check_valid_buffer(base, len, will_write);
+    total += len;
+  }
+#ifdef VM
+  for(i = 0; i < iovcnt; i++)
+    if(iov[i].iov_len > 0
+       && !page_pin_range(iov[i].iov_base, iov[i].iov_len, will_write))
+    {
+      /* Unpin the buffers pinned so far before giving up. */
+      while(i-- > 0)
+        if(iov[i].iov_len > 0)
+          page_unpin_range(iov[i].iov_base, iov[i].iov_len);
+      exit(-1);
+    }
+#endif
+  return total;
+}
+
+/* Unpins the IOVCNT buffers described by IOV, which
+   iov_prepare() pinned. */
+static void
+iov_release (struct iovec *iov, int iovcnt)
+{
+#ifdef VM
+  int i;
+
+  for(i = 0; i < iovcnt; i++)
+    if(iov[i].iov_len > 0)
+      page_unpin_range(iov[i].iov_base, iov[i].iov_len);
+#else
+  (void) iov;
+  (void) iovcnt;
+#endif
+}
+
+/* readv system call: reads from FD into each of the IOVCNT
+   buffers described by IOV in turn, stopping at end of file.
+   Returns the number of bytes actually read, or -1 if it could
+   not be read. */
+int readv (int fd, const struct iovec *uiov, int iovcnt)
+{
+  struct iovec iov[IOV_MAX];
+  struct file_elem *fe = NULL;
+  size_t total;
+  int ret = 0, i;
+
+  if(iovcnt < 0 || iovcnt > IOV_MAX) return -1;
+  if(fd == 1) return -1; // stdout
+  if(fd != 0)
+  {
+    fe = fd_lookup(fd);
+    if(!fe || fe->isdir) return -1;
+  }
+
+  total = iov_prepare(iov, uiov, iovcnt, true);
+  if(fd == 0)  //stdin
+  {
+    for(i = 0; i < iovcnt; i++)
+    {
+      uint8_t *buffer = iov[i].iov_base;
+      size_t j;
+
+      for(j = 0; j < iov[i].iov_len; j++)
+        buffer[j] = input_getc();
+    }
+    ret = total;
+  }
+  else
+  {
+    lock_acquire(&filesys_lock);
+    for(i = 0; i < iovcnt; i++)
+    {
+      off_t n = file_read(fe->file, iov[i].iov_base, iov[i].iov_len);
+      ret += n;
+      if((size_t) n < iov[i].iov_len) break; // end of file
     }
-    ret = file_read(fe->file, buffer, length);
     lock_release(&filesys_lock);
   }
+  iov_release(iov, iovcnt);
+
+  return ret;
+}
+
+/* writev system call: writes each of the IOVCNT buffers
+   described by IOV to FD in turn.  Returns the number of bytes
+   actually written. */
+int writev (int fd, const struct iovec *uiov, int iovcnt)
+{
+  struct iovec iov[IOV_MAX];
+  struct file_elem *fe = NULL;
+  int written = 0, i;
+
+  if(iovcnt < 0 || iovcnt > IOV_MAX) return -1;
+  if(fd == 0) exit(-1); // write to input (error)
+  if(fd != 1)
+  {
+    fe = fd_lookup(fd);
+    if(!fe || fe->isdir) exit(-1);
+  }
+
+  iov_prepare(iov, uiov, iovcnt, false);
+  lock_acquire(&filesys_lock);
+  for(i = 0; i < iovcnt; i++)
+  {
+    const char *buffer = iov[i].iov_base;
+    size_t length = iov[i].iov_len;
+
+    if(fd == 1)  // write to console, 512 bytes at a time
+    {
+      size_t ofs, chunk;
+
+      for(ofs = 0; ofs < length; ofs += chunk)
+      {
+        chunk = length - ofs < 512 ? length - ofs : 512;
+        putbuf(buffer + ofs, chunk);
+      }
+      written += length;
+    }
+    else
+    {
+      off_t n = file_write(fe->file, buffer, length);
+      written += n;
+      if((size_t) n < length) break; // file cannot grow
+    }
+  }
+  lock_release(&filesys_lock);
+  iov_release(iov, iovcnt);
+
+  return written;
+}
+
+/* pread system call: reads LENGTH bytes from FD, starting at
+   byte OFFSET, without using or changing FD's current position.
+   Returns the number of bytes actually read, or -1 if it could
+   not be read. */
+int pread (int fd, void *buffer, unsigned length, unsigned offset)
+{
+  struct file_elem *fe;
+  int ret;
 
+  check_valid_buffer(buffer, length, true);
+  if(offset > INT_MAX) return -1;
+  fe = fd_lookup(fd);
+  if(!fe || fe->isdir) return -1; // also rejects stdin and stdout
+#ifdef VM
+  /* Pin the buffer before taking any lock; see page_pin_range(). */
+  if(!page_pin_range(buffer, length, true)) exit(-1);
+#endif
+
+  lock_acquire(&filesys_lock);
+  ret = file_read_at(fe->file, buffer, length, offset);
+  lock_release(&filesys_lock);
+
+#ifdef VM
+  page_unpin_range(buffer, length);
+#endif
   return ret;
 }
 
+/* pwrite system call: writes LENGTH bytes to FD, starting at
+   byte OFFSET, without using or changing FD's current position.
+   Returns the number of bytes actually written. */
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset)
+{
+  struct file_elem *fe;
+  int written;
+
+  check_valid_buffer(buffer, length, false);
+  if(offset > INT_MAX) return -1;
+  if(fd == 0) exit(-1); // write to input (error)
+  if(fd == 1) return -1; // the console has no positions
+  fe = fd_lookup(fd);
+  if(!fe || fe->isdir) exit(-1);
+#ifdef VM
+  /* Pin the buffer before taking any lock; see page_pin_range(). */
+  if(!page_pin_range(buffer, length, false)) exit(-1);
+#endif
+
+  lock_acquire(&filesys_lock);
+  written = file_write_at(fe->file, buffer, length, offset);
+  lock_release(&filesys_lock);
+
+#ifdef VM
+  page_unpin_range(buffer, length);
+#endif
+  return written;
+}
+
+/* Performs the operation submitted in SQE, as if by the
+   corresponding system call, and returns its result. */
+static int
+ring_do (const struct ring_sqe *sqe)
+{
+  char *kstr;
+  int ret;
+
+  switch(sqe->op)
+  {
+    case RING_OP_NOP:
+      return 0;
+    case RING_OP_OPEN:
+      kstr = copy_in_string(sqe->buf);
+      ret = open(kstr);
+      palloc_free_page(kstr);
+      return ret;
+    case RING_OP_CLOSE:
+      close(sqe->fd);
+      return 0;
+    case RING_OP_READ:
+      return read(sqe->fd, sqe->buf, sqe->len);
+    case RING_OP_WRITE:
+      return write(sqe->fd, sqe->buf, sqe->len);
+    case RING_OP_PREAD:
+      return pread(sqe->fd, sqe->buf, sqe->len, sqe->offset);
+    case RING_OP_PWRITE:
+      return pwrite(sqe->fd, sqe->buf, sqe->len, sqe->offset);
+    default:
+      return -1;
+  }
+}
+
+/* ring_enter system call: performs the operations queued in
+   RING's submission ring, in order, posting a completion for
+   each, until the submission ring is empty or the completion
+   ring is full.  See lib/ring.h for the protocol.  Returns the
+   number of operations performed. */
+int ring_enter (struct ring *ring)
+{
+  unsigned sq_head, sq_tail, cq_head, cq_tail;
+  int done = 0;
+
+  if(copy_from_user(&sq_head, &ring->sq_head, sizeof sq_head) != 0
+     || copy_from_user(&sq_tail, &ring->sq_tail, sizeof sq_tail) != 0
+     || copy_from_user(&cq_head, &ring->cq_head, sizeof cq_head) != 0
+     || copy_from_user(&cq_tail, &ring->cq_tail, sizeof cq_tail) != 0)
+    exit(-1);
+  if(sq_tail - sq_head > RING_ENTRIES || cq_tail - cq_head > RING_ENTRIES)
+    exit(-1); // corrupt indexes
+
+  while(sq_head != sq_tail && cq_tail - cq_head < RING_ENTRIES)
+  {
+    struct ring_sqe sqe;
+    struct ring_cqe cqe;
+
+    if(copy_from_user(&sqe, &ring->sq[sq_head % RING_ENTRIES],
+                      sizeof sqe) != 0)
+      exit(-1);
+    cqe.user_data = sqe.user_data;
+    cqe.result = ring_do(&sqe);
+    if(copy_to_user(&ring->cq[cq_tail % RING_ENTRIES], &cqe,
+                    sizeof cqe) != 0)
+      exit(-1);
+    sq_head++;
+    cq_tail++;
+    done++;
+  }
+
+  if(copy_to_user(&ring->sq_head, &sq_head, sizeof sq_head) != 0
+     || copy_to_user(&ring->cq_tail, &cq_tail, sizeof cq_tail) != 0)
+    exit(-1);
+  return done;
+}
+
 /* seek system call */
 void seek (int fd, unsigned position)
 {
-  struct file_elem *fe = find_file_elem(fd);
+  struct file_elem *fe = fd_lookup(fd);
   if(!fe) exit(-1); // if the file could not be found, call exit(-1)
   struct file *f = fe->file;
   lock_acquire(&filesys_lock);
@@ -399,7 +833,7 @@ void seek (int fd, unsigned position)
 unsigned tell (int fd)
 { 
   unsigned ret;
-  struct file_elem *fe = find_file_elem(fd);
+  struct file_elem *fe = fd_lookup(fd);
   if(!fe) exit(-1); // if the file could not be found, call exit(-1)
   struct file *f = fe->file;
   lock_acquire(&filesys_lock);
@@ -413,7 +847,7 @@ unsigned tell (int fd)
 /* close system call */
 void close (int fd)
 {
-  struct file_elem *fe = find_file_elem(fd);
+  struct file_elem *fe = fd_remove(fd);
   if(!fe) exit(-1); // if the file could not be found, call exit(-1)
 
   lock_acquire(&filesys_lock);
@@ -425,11 +859,9 @@ void close (int fd)
   {
     file_close(fe->file);
   }
-
-  list_remove(&fe->thread_elem);
   lock_release(&filesys_lock);
 
-  free(fe);
+  kmem_cache_free(file_elem_cache, fe);
 }
 
 bool chdir(const char *dir)
@@ -443,20 +875,22 @@ bool mkdir(const char *dir)
   return filesys_create(dir, 0, true);
 }
 
-bool readdir(int fd, const char *name)
+bool readdir(int fd, char *name)
 {
-  struct file_elem *fe = find_file_elem(fd);
+  char kname[NAME_MAX + 1];
+  struct file_elem *fe = fd_lookup(fd);
 
   if(!fe) return false;
   if(!fe->isdir) return false;
-  if(!dir_readdir(fe->dir, name)) return false;
+  if(!dir_readdir(fe->dir, kname)) return false;
+  if(copy_to_user(name, kname, strlen(kname) + 1) != 0) exit(-1);
 
   return true;
 }
 
 bool isdir(int fd)
 {
-  struct file_elem *fe = find_file_elem(fd);
+  struct file_elem *fe = fd_lookup(fd);
 
   if(!fe) return false;
   return fe->isdir;
@@ -465,7 +899,7 @@ bool isdir(int fd)
 bool inumber(int fd)
 {
   block_sector_t inumber;
-  struct file_elem *fe = find_file_elem(fd);
+  struct file_elem *fe = fd_lookup(fd);
 
   if(!fe) return false;
   if(fe->isdir) inumber = inode_get_inumber(dir_get_inode(fe->dir));
@@ -473,3 +907,30 @@ bool inumber(int fd)
 
   return inumber;
 }
+
+
+#ifdef VM
+/**** Memory Mapping System Calls ****/
+
+/* mmap system call, maps the file open as fd at addr,
+   returns the mapping id, or -1 if it could not be mapped */
+mapid_t mmap (int fd, void *addr)
+{
+  struct file_elem *fe = fd_lookup(fd);
+  mapid_t ret;
+
+  if(!fe || fe->isdir) return -1;
+  lock_acquire(&filesys_lock);
+  ret = mmap_map(fe->file, addr);
+  lock_release(&filesys_lock);
+  return ret;
+}
+
+/* munmap system call, writes back and unmaps the mapping */
+void munmap (mapid_t mapping)
+{
+  lock_acquire(&filesys_lock);
+  mmap_unmap(mapping);
+  lock_release(&filesys_lock);
+}
+#endif
@@ -1,7 +1,9 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
-static struct lock filesys_lock; // lock for file system.
+#include "threads/synch.h"
+
+extern struct lock filesys_lock; // lock for file system.
 void syscall_init (void);
 
 #endif /* userprog/syscall.h */
@@ -0,0 +1,132 @@
+#include "userprog/uaccess.h"
+#include <debug.h>
+#include <stdint.h>
+#include "threads/vaddr.h"
+
+/* An entry in the exception table: if the instruction at INSN
+   faults on a user address, execution resumes at FIXUP. */
+struct ex_entry
+  {
+    uintptr_t insn;
+    uintptr_t fixup;
+  };
+
+/* The exception table, collected by the linker from every
+   __ex_table section.  See kernel.lds.S. */
+extern const struct ex_entry _start_ex_table[], _end_ex_table[];
+
+/* Emits an exception table entry for the instruction at label
+   INSN, with fixup at label FIXUP. */
+#define EX_ENTRY(INSN, FIXUP)                           \
+        ".pushsection __ex_table, \"a\"\n"              \
+        ".long " #INSN ", " #FIXUP "\n"                 \
+        ".popsection\n"
+
+/* Returns true if the SIZE bytes starting at UADDR lie entirely
+   in user virtual memory. */
+static inline bool
+is_user_range (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return start + size >= start && start + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* Copies SIZE bytes from SRC to DST, either of which may be in
+   user memory, and returns the number of bytes that could not be
+   copied because of a fault. */
+static size_t
+copy_user (void *dst, const void *src, size_t size)
+{
+  /* REP MOVSB is restartable: when it faults, ECX, ESI, and EDI
+     record how far it got, so it resumes after a page is read in
+     and leaves the remaining count in ECX if it gives up. */
+  asm volatile ("1: rep movsb\n"
+                "2:\n"
+                EX_ENTRY (1b, 2b)
+                : "+c" (size), "+D" (dst), "+S" (src)
+                :
+                : "memory");
+  return size;
+}
+
+/* Reads a byte at user virtual address UADDR.  Returns the byte
+   value if successful, -1 if a fault occurred. */
+static inline int
+get_user (const uint8_t *uaddr)
+{
+  int result;
+  asm volatile ("1: movzbl %1, %0\n"
+                "2:\n"
+                EX_ENTRY (1b, 2b)
+                : "=r" (result)
+                : "m" (*uaddr), "0" (-1));
+  return result;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Returns the number of bytes that could not be copied,
+   which is 0 if successful. */
+size_t
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  if (!is_user_range (usrc, size))
+    return size;
+  return copy_user (dst, usrc, size);
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns the number of bytes that could not be copied,
+   which is 0 if successful. */
+size_t
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  if (!is_user_range (udst, size))
+    return size;
+  return copy_user (udst, src, size);
+}
+
+/* Copies the null-terminated string at user address USRC into
+   the SIZE-byte kernel buffer DST.  Returns the length of the
+   string, not counting the null terminator, if successful.  If
+   the string does not fit, DST holds its first SIZE bytes,
+   without a null terminator, and the return value is SIZE.
+   Returns -1 if a fault occurred. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    {
+      int c;
+
+      if ((uintptr_t) usrc + i >= (uintptr_t) PHYS_BASE)
+        return -1;
+      c = get_user ((const uint8_t *) usrc + i);
+      if (c < 0)
+        return -1;
+      dst[i] = c;
+      if (c == '\0')
+        return i;
+    }
+  return size;
+}
+
+/* Called by the page fault handler for a fault in the kernel
+   that it could not resolve.  If the faulting instruction is one
+   of the user memory accesses above, redirects F to resume at
+   its fixup address and returns true.  Otherwise, returns
+   false. */
+bool
+uaccess_fixup (struct intr_frame *f)
+{
+  const struct ex_entry *e;
+
+  for (e = _start_ex_table; e < _end_ex_table; e++)
+    if (e->insn == (uintptr_t) f->eip)
+      {
+        f->eip = (void (*) (void)) e->fixup;
+        return true;
+      }
+  return false;
+}
@@ -0,0 +1,24 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/interrupt.h"
+
+/* Copying between kernel and user memory.
+
+   These functions access user memory directly, without first
+   checking that it is mapped.  If an access faults, and the page
+   fault handler cannot make the page accessible, the handler
+   resumes execution at a fixup address instead of killing the
+   process, and the function reports failure.  A system call can
+   then fail or exit cleanly instead of validating every page of
+   its arguments up front. */
+
+size_t copy_from_user (void *dst, const void *usrc, size_t size);
+size_t copy_to_user (void *udst, const void *src, size_t size);
+int strncpy_from_user (char *dst, const char *usrc, size_t size);
+
+bool uaccess_fixup (struct intr_frame *);
+
+#endif /* userprog/uaccess.h */
@@ -0,0 +1,356 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/page.h"
+
+/* Frame table.
+
+   Every user-pool frame that holds a process's page has an entry
+   in a single list, in allocation order.  When the user pool
+   runs dry, frame_alloc() takes a frame from some page instead,
+   choosing it with the clock (second-chance) algorithm: a hand
+   sweeps around the list, clearing the accessed bits of the
+   pages in each frame it passes, and stops at the first unpinned
+   frame whose bits were already clear, that is, one that has not
+   been touched for a whole revolution of the hand.
+
+   Frames holding a page of a process that is over its soft limit
+   on resident pages are taken first: the hand makes a pass that
+   considers only those frames before making one that considers
+   all of them.  A process at its hard limit takes a frame from
+   itself instead, with frame_evict_own().
+
+   Frames of read-only executable text are additionally entered
+   in a hash table keyed by inode and offset, so that a process
+   loading the same page of the same executable as another one
+   maps the existing frame instead of reading its own copy. */
+
+struct lock frame_lock;
+static struct list frame_table;
+
+/* Shared frames, keyed by inode and offset. */
+static struct hash shared_frames;
+
+/* The frame of zeros.  Not in the frame table. */
+static struct frame zero_frame;
+
+/* Next frame for the clock hand to examine, or the end of the
+   frame table to start over from the beginning. */
+static struct list_elem *clock_hand;
+
+static void *frame_evict (void);
+static void *clock_evict (bool over_soft_only);
+static bool frame_over_soft_limit (struct frame *);
+static struct frame *clock_advance (void);
+static void frame_free (struct frame *);
+static hash_hash_func shared_hash;
+static hash_less_func shared_less;
+
+/* Initializes the frame table. */
+void
+frame_init (void)
+{
+  lock_init (&frame_lock);
+  lock_set_name (&frame_lock, "frame");
+  list_init (&frame_table);
+  clock_hand = list_end (&frame_table);
+  if (!hash_init (&shared_frames, shared_hash, shared_less, NULL))
+    PANIC ("frame: shared frame table creation failed");
+
+  zero_frame.kpage = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  list_init (&zero_frame.pages);
+  zero_frame.pin_cnt = 1;
+  zero_frame.inode = NULL;
+  zero_frame.ofs = 0;
+}
+
+/* Allocates a frame for PAGE, if it is non-null, from the user
+   pool, evicting another page if the pool is exhausted.  FLAGS are passed to
+   palloc_get_page(); PAL_ZERO is honored for evicted frames too.
+   The new frame is pinned once, so that it cannot be taken away
+   before the caller fills it in and maps it; the caller unpins it
+   when done.  Returns a null pointer if no frame is free and none
+   can be evicted.  The caller must hold frame_lock. */
+struct frame *
+frame_alloc (struct page *page, enum palloc_flags flags)
+{
+  struct frame *f;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  f = malloc (sizeof *f);
+  if (f == NULL)
+    return NULL;
+
+  f->kpage = palloc_get_page (PAL_USER | flags);
+  if (f->kpage == NULL)
+    {
+      f->kpage = frame_evict ();
+      if (f->kpage == NULL)
+        {
+          free (f);
+          return NULL;
+        }
+      if (flags & PAL_ZERO)
+        memset (f->kpage, 0, PGSIZE);
+    }
+  list_init (&f->pages);
+  if (page != NULL)
+    list_push_back (&f->pages, &page->frame_elem);
+  f->pin_cnt = 1;
+  f->inode = NULL;
+  f->ofs = 0;
+  list_push_back (&frame_table, &f->elem);
+  return f;
+}
+
+/* Adds PAGE to the pages held in F.  The caller must hold
+   frame_lock. */
+void
+frame_add_page (struct frame *f, struct page *page)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  list_push_back (&f->pages, &page->frame_elem);
+}
+
+/* Removes PAGE, which must already be unmapped, from the pages
+   held in F, and frees F if that was the last one.  The caller
+   must hold frame_lock. */
+void
+frame_remove_page (struct frame *f, struct page *page)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  list_remove (&page->frame_elem);
+  if (list_empty (&f->pages) && f != &zero_frame)
+    frame_free (f);
+}
+
+/* Returns the frame of zeros, to be mapped read-only. */
+struct frame *
+frame_zero (void)
+{
+  return &zero_frame;
+}
+
+/* Returns true if F holds more than one page, or is the frame of
+   zeros, so that a page in F that is written must first be
+   copied to a frame of its own. */
+bool
+frame_is_shared (struct frame *f)
+{
+  return (f == &zero_frame
+          || (!list_empty (&f->pages)
+              && list_front (&f->pages) != list_back (&f->pages)));
+}
+
+/* Enters F, which holds the page of read-only executable text at
+   offset OFS in INODE, in the shared frame table.  The caller
+   must hold frame_lock. */
+void
+frame_share (struct frame *f, struct inode *inode, off_t ofs)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (f->inode == NULL && inode != NULL);
+
+  f->inode = inode;
+  f->ofs = ofs;
+  hash_insert (&shared_frames, &f->hash_elem);
+}
+
+/* Returns the shared frame holding the page at offset OFS in
+   INODE, or a null pointer if there is none.  The caller must
+   hold frame_lock. */
+struct frame *
+frame_lookup_shared (struct inode *inode, off_t ofs)
+{
+  struct frame key;
+  struct hash_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  key.inode = inode;
+  key.ofs = ofs;
+  e = hash_find (&shared_frames, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct frame, hash_elem) : NULL;
+}
+
+/* Removes F from the frame table, and from the shared frame
+   table if it is there, and frees it, but not its memory. */
+static void
+frame_remove (struct frame *f)
+{
+  if (clock_hand == &f->elem)
+    clock_hand = list_next (clock_hand);
+  list_remove (&f->elem);
+  if (f->inode != NULL)
+    hash_delete (&shared_frames, &f->hash_elem);
+  free (f);
+}
+
+/* Removes F from the frame table and returns its memory to the
+   user pool. */
+static void
+frame_free (struct frame *f)
+{
+  void *kpage = f->kpage;
+
+  frame_remove (f);
+  palloc_free_page (kpage);
+}
+
+/* Evicts one of T's resident pages that has not been accessed
+   recently, leaving the frame to any other pages it holds or
+   returning it to the user pool, so that T stays within its hard
+   limit.  Returns true if successful, false if T has no page
+   that can be evicted.  The caller must hold frame_lock. */
+bool
+frame_evict_own (struct thread *t)
+{
+  size_t tries = 2 * list_size (&frame_table);
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  while (tries-- > 0)
+    {
+      struct frame *f = clock_advance ();
+      struct list_elem *e;
+
+      if (f->pin_cnt > 0)
+        continue;
+      for (e = list_begin (&f->pages); e != list_end (&f->pages);
+           e = list_next (e))
+        {
+          struct page *p = list_entry (e, struct page, frame_elem);
+
+          if (p->owner != t || page_accessed_recently (p))
+            continue;
+          if (!page_out (p))
+            continue;
+          frame_remove_page (f, p);
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Chooses a frame to evict with the clock algorithm, preferring
+   frames of processes over their soft limits, writes its pages
+   out, and returns the frame's kernel address for reuse.
+   Returns a null pointer if every frame is pinned or no page
+   could be written out. */
+static void *
+frame_evict (void)
+{
+  void *kpage = clock_evict (true);
+
+  return kpage != NULL ? kpage : clock_evict (false);
+}
+
+/* Does the work of frame_evict(), considering only frames that
+   hold a page of a process over its soft limit if OVER_SOFT_ONLY
+   is true. */
+static void *
+clock_evict (bool over_soft_only)
+{
+  /* Two revolutions suffice: the first clears every accessed
+     bit, so the second finds an unreferenced frame unless all of
+     them are pinned or cannot be written out. */
+  size_t tries = 2 * list_size (&frame_table);
+
+  while (tries-- > 0)
+    {
+      struct frame *f = clock_advance ();
+      bool accessed = false;
+      struct list_elem *e;
+      void *kpage;
+
+      if (f->pin_cnt > 0)
+        continue;
+      if (over_soft_only && !frame_over_soft_limit (f))
+        continue;
+      for (e = list_begin (&f->pages); e != list_end (&f->pages);
+           e = list_next (e))
+        if (page_accessed_recently (list_entry (e, struct page, frame_elem)))
+          accessed = true;
+      if (accessed)
+        continue;
+
+      /* If a page cannot be written out, the frame stays, holding
+         the pages that remain.  Those already written out are
+         simply faulted back in on their next access. */
+      for (e = list_begin (&f->pages); e != list_end (&f->pages); )
+        {
+          struct page *p = list_entry (e, struct page, frame_elem);
+          if (!page_out (p))
+            break;
+          e = list_remove (e);
+        }
+      if (!list_empty (&f->pages))
+        continue;
+
+      kpage = f->kpage;
+      frame_remove (f);
+      return kpage;
+    }
+  return NULL;
+}
+
+/* Returns true if F holds a page of a process that has more
+   resident pages than its soft limit. */
+static bool
+frame_over_soft_limit (struct frame *f)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct page, frame_elem)->owner;
+
+      if (t->vmstat.resident > t->rss_soft_limit)
+        return true;
+    }
+  return false;
+}
+
+/* Returns the frame under the clock hand and moves the hand to
+   the next one.  The frame table must not be empty. */
+static struct frame *
+clock_advance (void)
+{
+  struct frame *f;
+
+  ASSERT (!list_empty (&frame_table));
+
+  if (clock_hand == list_end (&frame_table))
+    clock_hand = list_begin (&frame_table);
+  f = list_entry (clock_hand, struct frame, elem);
+  clock_hand = list_next (clock_hand);
+  return f;
+}
+
+/* Returns a hash value for the shared frame at E. */
+static unsigned
+shared_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, hash_elem);
+  return hash_bytes (&f->inode, sizeof f->inode) ^ hash_int (f->ofs);
+}
+
+/* Returns true if shared frame A precedes shared frame B. */
+static bool
+shared_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, hash_elem);
+  const struct frame *b = hash_entry (b_, struct frame, hash_elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  return a->ofs < b->ofs;
+}
@@ -0,0 +1,62 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+
+struct inode;
+struct page;
+struct thread;
+
+/* A frame of physical memory from the user pool, holding a page
+   of one or more processes.
+
+   Most frames hold a single private page.  A frame of read-only
+   executable text is shared instead by every process that maps
+   the same page of the same file: it is entered in a table of
+   shared frames keyed by INODE and OFS, and PAGES lists all of
+   the pages mapped to it.  The frame is freed when the last of
+   them goes away.
+
+   Untouched zero-filled pages of every process are all mapped,
+   read-only, to one frame of zeros, which is never evicted or
+   freed.  Similarly, after fork() the parent's and the child's
+   copies of a writable page share its frame, read-only.  A
+   process gets a private frame for such a page the first time
+   it writes to it. */
+struct frame
+  {
+    void *kpage;                /* Kernel virtual address. */
+    struct list pages;          /* Pages held in this frame. */
+    unsigned pin_cnt;           /* Exempt from eviction while nonzero. */
+    struct list_elem elem;      /* Element in frame table. */
+
+    /* Shared frames only. */
+    struct inode *inode;        /* File contents come from, or null. */
+    off_t ofs;                  /* Offset in file. */
+    struct hash_elem hash_elem; /* Element in shared frame table. */
+  };
+
+/* Serializes the frame table and every transition of a page
+   between resident and non-resident: page-in, eviction, and
+   teardown at process exit.  Held across the disk I/O those
+   involve, so a thread that faults on a page being evicted waits
+   until the eviction is complete. */
+extern struct lock frame_lock;
+
+void frame_init (void);
+struct frame *frame_alloc (struct page *, enum palloc_flags);
+void frame_add_page (struct frame *, struct page *);
+void frame_remove_page (struct frame *, struct page *);
+bool frame_evict_own (struct thread *);
+
+struct frame *frame_zero (void);
+bool frame_is_shared (struct frame *);
+void frame_share (struct frame *, struct inode *, off_t);
+struct frame *frame_lookup_shared (struct inode *, off_t);
+
+#endif /* vm/frame.h */
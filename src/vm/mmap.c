@@ -0,0 +1,140 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <round.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
+#include "vm/page.h"
+
+/* Memory-mapped files.
+
+   A mapping is a run of consecutive pages in the supplemental
+   page table, each backed by one page of the file.  Nothing is
+   read when the mapping is created: pages are read in by the
+   page fault handler on first access, like an executable's.
+   Modified pages are written back to the file, rather than to
+   swap, when they are evicted or unmapped. */
+
+static struct mapping *mmap_find (int id);
+static void mmap_release (struct mapping *);
+
+/* Maps FILE into the current process's address space starting
+   at ADDR and returns the new mapping's identifier, or -1 if
+   ADDR is null or not page-aligned, FILE is empty, the pages
+   needed overlap the address space or the region reserved for
+   the stack, or memory allocation fails.  The mapping uses its own reopened copy of FILE, so
+   FILE may be closed without affecting it. */
+int
+mmap_map (struct file *file, void *addr)
+{
+  struct thread *t = thread_current ();
+  struct mapping *m;
+  off_t length;
+  size_t i;
+
+  if (addr == NULL || pg_ofs (addr) != 0)
+    return -1;
+  length = file_length (file);
+  if (length == 0)
+    return -1;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return -1;
+  m->file = file_reopen (file);
+  if (m->file == NULL)
+    {
+      free (m);
+      return -1;
+    }
+  m->base = addr;
+  m->page_cnt = DIV_ROUND_UP (length, PGSIZE);
+
+  for (i = 0; i < m->page_cnt; i++)
+    {
+      uint8_t *upage = (uint8_t *) m->base + i * PGSIZE;
+      off_t ofs = i * PGSIZE;
+      size_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+
+      if (!is_user_vaddr (upage) || page_is_stack (upage)
+          || !page_alloc_mmap (upage, m->file, ofs, read_bytes))
+        {
+          m->page_cnt = i;
+          mmap_release (m);
+          return -1;
+        }
+    }
+
+  m->id = t->next_mapid++;
+  list_push_back (&t->mappings, &m->elem);
+  return m->id;
+}
+
+/* Unmaps the current process's mapping ID, writing modified
+   pages back to the file.  Returns false if there is no such
+   mapping.  The caller must hold filesys_lock. */
+bool
+mmap_unmap (int id)
+{
+  struct mapping *m = mmap_find (id);
+
+  if (m == NULL)
+    return false;
+  list_remove (&m->elem);
+  mmap_release (m);
+  return true;
+}
+
+/* Unmaps all of the current process's mappings.  Called at
+   process exit, before the supplemental page table is
+   destroyed. */
+void
+mmap_unmap_all (void)
+{
+  struct thread *t = thread_current ();
+
+  if (list_empty (&t->mappings))
+    return;
+
+  lock_acquire (&filesys_lock);
+  while (!list_empty (&t->mappings))
+    {
+      struct list_elem *e = list_pop_front (&t->mappings);
+      mmap_release (list_entry (e, struct mapping, elem));
+    }
+  lock_release (&filesys_lock);
+}
+
+/* Returns the current process's mapping ID, or a null pointer if
+   there is none. */
+static struct mapping *
+mmap_find (int id)
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&t->mappings); e != list_end (&t->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->id == id)
+        return m;
+    }
+  return NULL;
+}
+
+/* Removes M's pages from the address space, writing back those
+   that were modified, then closes M's file and frees M.  The
+   caller must hold filesys_lock. */
+static void
+mmap_release (struct mapping *m)
+{
+  size_t i;
+
+  for (i = 0; i < m->page_cnt; i++)
+    page_free ((uint8_t *) m->base + i * PGSIZE);
+  file_close (m->file);
+  free (m);
+}
@@ -0,0 +1,24 @@
+#ifndef VM_MMAP_H
+#define VM_MMAP_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct file;
+
+/* A memory-mapped file. */
+struct mapping
+  {
+    int id;                     /* Mapping identifier. */
+    struct file *file;          /* The file, reopened for the mapping. */
+    void *base;                 /* User address of first page. */
+    size_t page_cnt;            /* Number of pages mapped. */
+    struct list_elem elem;      /* Element in thread's `mappings'. */
+  };
+
+int mmap_map (struct file *, void *addr);
+bool mmap_unmap (int id);
+void mmap_unmap_all (void);
+
+#endif /* vm/mmap.h */
@@ -0,0 +1,823 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+
+/* Supplemental page table.
+
+   Each process has a hash table of `struct page's, keyed by user
+   virtual page address, describing every page of its address
+   space that is not necessarily resident.  load() records the
+   pages of the executable's segments here instead of reading
+   them in, and page_in() reads a page when it is first
+   touched, so that starting a process only costs the pages it
+   actually uses.
+
+   When memory runs short, the frame table evicts pages with
+   page_out() and page_in() brings them back, from swap if they
+   were modified and from their original source otherwise.
+
+   The user stack starts out as a single page and grows down on
+   demand: page_grow_stack() adds a zero page for a fault that
+   looks like a stack access, up to stack_page_limit pages below
+   PHYS_BASE.
+
+   The counters in each thread's `struct vmstat' are kept up to
+   date here, under frame_lock, as pages move in and out of
+   memory.  Pages mapped to the frame of zeros take no memory of
+   their own and are not counted as resident.
+
+   A process may have soft and hard limits on its resident pages.
+   A process at its hard limit must evict one of its own pages to
+   bring in another; see make_room().  Processes over their soft
+   limit are merely the first to lose pages when the user pool
+   runs short; see frame_alloc(). */
+
+/* Maximum size of a user stack, in pages.  Set by the -stk
+   kernel command line option. */
+size_t stack_page_limit = STACK_PAGES_DEFAULT;
+
+/* If true, processes print their statistics when they exit.
+   Set by the -vmstat kernel command line option. */
+bool page_stats_report;
+
+/* Default resident page limits for new processes.  Set by the
+   -rss-soft and -rss-hard kernel command line options. */
+size_t rss_soft_page_limit = SIZE_MAX;
+size_t rss_hard_page_limit = SIZE_MAX;
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static void page_destroy (struct hash_elem *, void *aux);
+static bool page_insert (struct page *);
+static struct page *page_create (void *upage, struct file *, off_t ofs,
+                                 size_t read_bytes, bool writable);
+static bool page_load (struct page *);
+static bool page_unshare (struct page *);
+static bool page_fork (struct page *, struct file *exec);
+static bool is_stack_access (const void *uaddr);
+static bool page_write_back (struct page *);
+static bool make_room (struct thread *);
+
+/* Creates an empty supplemental page table for the current
+   process.  Returns true if successful, false on memory
+   allocation failure. */
+bool
+page_table_create (void)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (t->pages == NULL);
+
+  t->rss_soft_limit = rss_soft_page_limit;
+  t->rss_hard_limit = rss_hard_page_limit;
+  t->pages = malloc (sizeof *t->pages);
+  if (t->pages == NULL)
+    return false;
+  if (!hash_init (t->pages, page_hash, page_less, NULL))
+    {
+      free (t->pages);
+      t->pages = NULL;
+      return false;
+    }
+  return true;
+}
+
+/* Copies PARENT's supplemental page table, for fork(), into the
+   current process's, which must be empty.  Pages of PARENT's
+   executable are backed by EXEC in the copy.  Memory-mapped
+   files are not inherited.  Returns true if successful, false
+   if memory allocation fails.  PARENT must be blocked
+   throughout.
+
+   Resident writable pages are not copied.  Instead, both
+   processes map the same frame read-only, and whichever one
+   writes to the page first gets its own copy; see
+   page_copy_on_write(). */
+bool
+page_table_fork (struct thread *parent, struct file *exec)
+{
+  struct hash_iterator i;
+  bool success = true;
+
+  lock_acquire (&frame_lock);
+  hash_first (&i, parent->pages);
+  while (success && hash_next (&i))
+    {
+      struct page *pp = hash_entry (hash_cur (&i), struct page, hash_elem);
+
+      if (!pp->mmap)
+        success = page_fork (pp, exec);
+    }
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Destroys the current process's supplemental page table, if it
+   has one, freeing its frames and swap slots.  Must be called
+   before the page directory is destroyed. */
+void
+page_table_destroy (void)
+{
+  struct thread *t = thread_current ();
+
+  if (t->pages == NULL)
+    return;
+  lock_acquire (&frame_lock);
+  hash_destroy (t->pages, page_destroy);
+  lock_release (&frame_lock);
+  free (t->pages);
+  t->pages = NULL;
+}
+
+/* Returns the current process's page containing user virtual
+   address UADDR, or a null pointer if there is none. */
+struct page *
+page_lookup (const void *uaddr)
+{
+  struct thread *t = thread_current ();
+  struct page p;
+  struct hash_elem *e;
+
+  if (t->pages == NULL || !is_user_vaddr (uaddr))
+    return NULL;
+
+  p.upage = pg_round_down (uaddr);
+  e = hash_find (t->pages, &p.hash_elem);
+  return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+}
+
+/* Adds a page at UPAGE to the current process's address space,
+   to be filled with READ_BYTES bytes from FILE starting at
+   offset OFS followed by zeros, when it is first accessed.  The
+   page is read/write if WRITABLE is true, read-only otherwise.
+   FILE must stay open as long as the page exists.
+   Returns true if successful, false if UPAGE is already part of
+   the address space or memory allocation fails. */
+bool
+page_alloc_file (void *upage, struct file *file, off_t ofs,
+                 size_t read_bytes, bool writable)
+{
+  return page_create (upage, file, ofs, read_bytes, writable) != NULL;
+}
+
+/* Adds a page at UPAGE to the current process's address space,
+   to be zero-filled when it is first accessed.  Returns true if
+   successful, false if UPAGE is already part of the address
+   space or memory allocation fails. */
+bool
+page_alloc_zero (void *upage, bool writable)
+{
+  return page_alloc_file (upage, NULL, 0, 0, writable);
+}
+
+/* Adds a writable page at UPAGE to the current process's address
+   space that maps READ_BYTES bytes of FILE starting at offset
+   OFS.  Unlike a page added with page_alloc_file(), changes to
+   the page are written back to FILE.  READ_BYTES must be
+   nonzero.  Returns true if successful, false if UPAGE is
+   already part of the address space or memory allocation
+   fails. */
+bool
+page_alloc_mmap (void *upage, struct file *file, off_t ofs,
+                 size_t read_bytes)
+{
+  struct page *p;
+
+  ASSERT (file != NULL && read_bytes > 0);
+
+  p = page_create (upage, file, ofs, read_bytes, true);
+  if (p == NULL)
+    return false;
+  p->mmap = true;
+  return true;
+}
+
+/* Removes the page at UPAGE from the current process's address
+   space, writing it back to its file first if it is a modified
+   page of a memory-mapped file. */
+void
+page_free (void *upage)
+{
+  struct thread *t = thread_current ();
+  struct page *p = page_lookup (upage);
+
+  ASSERT (p != NULL);
+
+  lock_acquire (&frame_lock);
+  hash_delete (t->pages, &p->hash_elem);
+  page_destroy (&p->hash_elem, NULL);
+  lock_release (&frame_lock);
+}
+
+/* Brings the page containing UADDR into memory, if it belongs to
+   the current process's address space and is not resident.
+   Returns true if the page is resident on return, false if UADDR
+   is not part of the address space or the page could not be
+   read. */
+bool
+page_in (const void *uaddr)
+{
+  struct page *p = page_lookup (uaddr);
+  bool success = true;
+
+  if (p == NULL)
+    return false;
+
+  lock_acquire (&frame_lock);
+  if (p->frame == NULL)
+    {
+      success = page_load (p);
+      if (success)
+        p->frame->pin_cnt--;
+    }
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Handles a write to the page containing UADDR that faulted
+   because the page is mapped read-only to a shared frame, by
+   giving the page a private copy of the frame, or just mapping
+   it read/write if no other page shares the frame any longer.  Returns true if
+   the faulting access should be retried, false if UADDR is not
+   a writable page of the current process's address space or no
+   frame is available. */
+bool
+page_copy_on_write (const void *uaddr)
+{
+  struct page *p = page_lookup (uaddr);
+  bool success = true;
+
+  if (p == NULL || !p->writable)
+    return false;
+
+  lock_acquire (&frame_lock);
+  if (p->frame != NULL && frame_is_shared (p->frame))
+    {
+      success = page_unshare (p);
+      if (success)
+        p->frame->pin_cnt--;
+    }
+  else if (p->frame != NULL)
+    {
+      /* The other processes sharing the frame have all made their
+         own copies or exited, so the frame is ours alone. */
+      uint32_t *pd = p->owner->pagedir;
+
+      if (pagedir_is_dirty (pd, p->upage))
+        p->dirty = true;
+      pagedir_clear_page (pd, p->upage);
+      if (!pagedir_set_page (pd, p->upage, p->frame->kpage, true))
+        NOT_REACHED ();
+      p->owner->vmstat.cow_breaks++;
+    }
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Adds a zero page containing UADDR to the current process's
+   stack and brings it into memory, if UADDR is not yet part of
+   the address space and looks like an access to the stack.
+   Returns true if successful, false otherwise. */
+bool
+page_grow_stack (const void *uaddr)
+{
+  void *upage = pg_round_down (uaddr);
+
+  return (is_stack_access (uaddr)
+          && page_lookup (upage) == NULL
+          && page_alloc_zero (upage, true)
+          && page_in (upage));
+}
+
+/* Returns true if UADDR lies in the region reserved for the user
+   stack, whether or not the stack has grown that far. */
+bool
+page_is_stack (const void *uaddr)
+{
+  return ((uint8_t *) uaddr < (uint8_t *) PHYS_BASE
+          && (uint8_t *) uaddr >= (uint8_t *) PHYS_BASE
+                                  - stack_page_limit * PGSIZE);
+}
+
+/* Returns true if an access to UADDR, which is not part of the
+   current process's address space, should grow its stack.
+
+   The 80x86 PUSH and PUSHA instructions check access
+   permissions before adjusting the stack pointer, so they fault
+   up to 32 bytes below it.  Any access further below the stack
+   pointer is a bug, not stack growth.  The stack pointer is the
+   one saved on the most recent entry into the kernel from user
+   mode, so this works for faults in system calls too. */
+static bool
+is_stack_access (const void *uaddr)
+{
+  const uint8_t *esp = thread_current ()->user_esp;
+
+  return page_is_stack (uaddr) && (const uint8_t *) uaddr >= esp - 32;
+}
+
+/* Brings every page overlapping the SIZE bytes starting at
+   UADDR into memory and pins it there, until a matching call to
+   page_unpin_range().  Stack pages are added as needed.
+   Returns true if successful, false if any of them is not part
+   of the current process's address space, is read-only and
+   WILL_WRITE is true, or cannot be read, in which case no page
+   is left pinned.
+
+   The kernel calls this on a user buffer before doing I/O on
+   it: a page fault taken while a device driver holds its lock
+   would need that same lock to read the page in, and so would
+   evicting a page from under the I/O to make room. */
+bool
+page_pin_range (const void *uaddr, size_t size, bool will_write)
+{
+  const uint8_t *upage;
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+  bool success = true;
+
+  if (size == 0)
+    return true;
+  if (end < (const uint8_t *) uaddr)
+    return false;
+
+  lock_acquire (&frame_lock);
+  for (upage = pg_round_down (uaddr); upage < end; upage += PGSIZE)
+    {
+      const void *addr = upage < (const uint8_t *) uaddr ? uaddr : upage;
+      struct page *p = page_lookup (upage);
+
+      if (p == NULL && is_stack_access (addr))
+        p = page_create ((void *) upage, NULL, 0, 0, true);
+
+      if (p == NULL || (will_write && !p->writable))
+        success = false;
+      else if (p->frame != NULL)
+        p->frame->pin_cnt++;
+      else
+        success = page_load (p);
+
+      /* The kernel's writes must land in a private copy. */
+      if (success && will_write && frame_is_shared (p->frame))
+        {
+          p->frame->pin_cnt--;
+          success = page_unshare (p);
+        }
+      if (!success)
+        break;
+    }
+  lock_release (&frame_lock);
+
+  /* A frame shared with other processes would otherwise stay
+     pinned after we exit. */
+  if (!success && upage > (const uint8_t *) uaddr)
+    page_unpin_range (uaddr, upage - (const uint8_t *) uaddr);
+  return success;
+}
+
+/* Unpins the pages overlapping the SIZE bytes starting at UADDR,
+   which must have been pinned by page_pin_range(). */
+void
+page_unpin_range (const void *uaddr, size_t size)
+{
+  const uint8_t *upage;
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+
+  if (size == 0)
+    return;
+
+  lock_acquire (&frame_lock);
+  for (upage = pg_round_down (uaddr); upage < end; upage += PGSIZE)
+    {
+      struct page *p = page_lookup (upage);
+
+      ASSERT (p != NULL && p->frame != NULL && p->frame->pin_cnt > 0);
+      p->frame->pin_cnt--;
+    }
+  lock_release (&frame_lock);
+}
+
+/* Prints the current process's virtual memory statistics. */
+void
+page_print_stats (void)
+{
+  struct thread *t = thread_current ();
+  const struct vmstat *s = &t->vmstat;
+
+  printf ("%s: %u minor faults, %u major (%u from files), "
+          "%u copy-on-write breaks, %u pages resident, %u swapped\n",
+          t->name, s->minor_faults, s->major_faults, s->file_pageins,
+          s->cow_breaks, s->resident, s->swapped);
+}
+
+/* Returns true if resident page P has been accessed since the
+   last call, clearing its accessed bit.  The caller must hold
+   frame_lock. */
+bool
+page_accessed_recently (struct page *p)
+{
+  uint32_t *pd = p->owner->pagedir;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (p->frame != NULL);
+
+  if (!pagedir_is_accessed (pd, p->upage))
+    return false;
+  pagedir_set_accessed (pd, p->upage, false);
+  return true;
+}
+
+/* Evicts resident page P from its frame, writing it to swap or,
+   for a memory-mapped page, to its file if it has been modified,
+   and unmaps it.  The frame itself, and P's place in it, are left
+   for the caller to deal with.  Returns true if successful,
+   false if P must be written to swap but swap is full, or
+   written back to its file but filesys_lock is busy, in which
+   case P stays resident.  The caller must hold frame_lock. */
+bool
+page_out (struct page *p)
+{
+  uint32_t *pd = p->owner->pagedir;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (p->frame != NULL && p->frame->pin_cnt == 0);
+
+  /* Unmap the page before writing it out, so that its owner
+     faults and waits for us instead of modifying it under the
+     write. */
+  if (pagedir_is_dirty (pd, p->upage))
+    p->dirty = true;
+  pagedir_clear_page (pd, p->upage);
+
+  if (p->dirty && p->mmap)
+    {
+      if (!page_write_back (p))
+        {
+          pagedir_set_page (pd, p->upage, p->frame->kpage, p->writable);
+          return false;
+        }
+    }
+  else if (p->dirty)
+    {
+      p->swap_slot = swap_out (p->frame->kpage);
+      if (p->swap_slot == SWAP_NONE)
+        {
+          pagedir_set_page (pd, p->upage, p->frame->kpage, p->writable);
+          return false;
+        }
+      p->owner->vmstat.swapped++;
+    }
+  p->frame = NULL;
+  p->owner->vmstat.resident--;
+  return true;
+}
+
+/* Reads non-resident page P into a newly allocated frame and maps
+   it, or maps the existing frame if P is read-only executable
+   text that another process already has in memory or a page of
+   zeros.  In the latter case, the page is mapped read-only even
+   if it is writable; see page_copy_on_write().  The frame is
+   left pinned once.  Returns true if successful, false if no
+   frame is available or P cannot be read.  The caller must hold
+   frame_lock. */
+static bool
+page_load (struct page *p)
+{
+  uint32_t *pd = p->owner->pagedir;
+  struct inode *inode = NULL;
+  struct frame *f;
+  bool zero = p->file == NULL && p->swap_slot == SWAP_NONE;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (p->frame == NULL);
+
+  /* Read-only pages of a file, other than mapped ones, can only
+     ever hold the file's contents, which load() keeps from
+     changing by denying writes to the executable. */
+  if (p->file != NULL && !p->writable && !p->mmap)
+    {
+      inode = file_get_inode (p->file);
+      f = frame_lookup_shared (inode, p->file_ofs);
+      if (f != NULL)
+        {
+          /* Pin F first, so that making room can't evict it. */
+          f->pin_cnt++;
+          if (!make_room (p->owner)
+              || !pagedir_set_page (pd, p->upage, f->kpage, false))
+            {
+              f->pin_cnt--;
+              return false;
+            }
+          frame_add_page (f, p);
+          p->frame = f;
+          p->owner->vmstat.minor_faults++;
+          p->owner->vmstat.resident++;
+          return true;
+        }
+    }
+
+  /* A page of zeros is mapped read-only to the frame of zeros
+     until it is first written. */
+  if (zero)
+    {
+      f = frame_zero ();
+      if (!pagedir_set_page (pd, p->upage, f->kpage, false))
+        return false;
+      frame_add_page (f, p);
+      f->pin_cnt++;
+      p->frame = f;
+      p->owner->vmstat.minor_faults++;
+      return true;
+    }
+
+  if (!make_room (p->owner))
+    return false;
+  f = frame_alloc (p, 0);
+  if (f == NULL)
+    return false;
+
+  if (p->swap_slot != SWAP_NONE)
+    {
+      swap_in (p->swap_slot, f->kpage);
+      swap_free (p->swap_slot);
+      p->swap_slot = SWAP_NONE;
+      p->owner->vmstat.swapped--;
+    }
+  else if (p->file != NULL)
+    {
+      uint8_t *kpage = f->kpage;
+
+      if (file_read_at (p->file, kpage, p->read_bytes, p->file_ofs)
+          != (off_t) p->read_bytes)
+        {
+          frame_remove_page (f, p);
+          return false;
+        }
+      memset (kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+      p->owner->vmstat.file_pageins++;
+    }
+
+  if (!pagedir_set_page (pd, p->upage, f->kpage, p->writable))
+    {
+      frame_remove_page (f, p);
+      return false;
+    }
+  if (inode != NULL)
+    frame_share (f, inode, p->file_ofs);
+  p->frame = f;
+  p->owner->vmstat.major_faults++;
+  p->owner->vmstat.resident++;
+  return true;
+}
+
+/* Gives writable page P, which is mapped read-only to a shared
+   frame, a private copy of the frame and maps it read/write.
+   The new frame is left pinned once.  Returns true if
+   successful, false if no frame is available.  The caller must
+   hold frame_lock. */
+static bool
+page_unshare (struct page *p)
+{
+  uint32_t *pd = p->owner->pagedir;
+  struct frame *old = p->frame;
+  struct frame *f;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (p->writable && old != NULL && frame_is_shared (old));
+
+  /* A page mapped to the frame of zeros becomes resident now.
+     Keep the old frame from being evicted while we copy it. */
+  old->pin_cnt++;
+  if (old == frame_zero () && !make_room (p->owner))
+    f = NULL;
+  else
+    f = frame_alloc (NULL, old == frame_zero () ? PAL_ZERO : 0);
+  old->pin_cnt--;
+  if (f == NULL)
+    return false;
+  if (old != frame_zero ())
+    {
+      memcpy (f->kpage, old->kpage, PGSIZE);
+      p->owner->vmstat.cow_breaks++;
+    }
+  else
+    p->owner->vmstat.resident++;
+
+  pagedir_clear_page (pd, p->upage);
+  if (!pagedir_set_page (pd, p->upage, f->kpage, true))
+    NOT_REACHED ();
+  frame_remove_page (old, p);
+  frame_add_page (f, p);
+  p->frame = f;
+  return true;
+}
+
+/* Adds a copy of parent page PP to the current process's address
+   space, sharing PP's frame if it is resident.  Pages of PP's
+   executable are backed by EXEC in the copy.  A resident copy
+   counts against the current process's hard limit like any
+   other; see make_room().  Returns true if successful, false if
+   memory allocation fails or the copy cannot be made resident
+   within the limit.  The caller must hold frame_lock. */
+static bool
+page_fork (struct page *pp, struct file *exec)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  struct page *p;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (!pp->mmap);
+
+  p = page_create (pp->upage, exec, pp->file_ofs, pp->read_bytes,
+                   pp->writable);
+  if (p == NULL)
+    return false;
+
+  if (pp->frame != NULL)
+    {
+      uint32_t *ppd = pp->owner->pagedir;
+      void *kpage = pp->frame->kpage;
+
+      /* Write-protect the parent's mapping, keeping track of
+         whether the page was modified. */
+      if (pp->writable)
+        {
+          if (pagedir_is_dirty (ppd, pp->upage))
+            pp->dirty = true;
+          pagedir_clear_page (ppd, pp->upage);
+          if (!pagedir_set_page (ppd, pp->upage, kpage, false))
+            NOT_REACHED ();
+        }
+      if (pp->frame != frame_zero () && !make_room (p->owner))
+        return false;
+      if (!pagedir_set_page (pd, p->upage, kpage, false))
+        return false;
+      frame_add_page (pp->frame, p);
+      p->frame = pp->frame;
+      if (p->frame != frame_zero ())
+        p->owner->vmstat.resident++;
+    }
+  else if (pp->swap_slot != SWAP_NONE)
+    {
+      /* Swap slots belong to a single page, so read in a copy. */
+      struct frame *f;
+
+      if (!make_room (p->owner))
+        return false;
+      f = frame_alloc (p, 0);
+      if (f == NULL)
+        return false;
+      swap_in (pp->swap_slot, f->kpage);
+      if (!pagedir_set_page (pd, p->upage, f->kpage, true))
+        {
+          frame_remove_page (f, p);
+          return false;
+        }
+      f->pin_cnt--;
+      p->frame = f;
+      p->owner->vmstat.resident++;
+    }
+  p->dirty = pp->dirty;
+  return true;
+}
+
+/* Makes room for one more resident page of process T within its
+   hard limit, by evicting one of its own pages if it is at the
+   limit.  Returns true if successful, false if T is at its limit
+   and none of its pages can be evicted.  The caller must hold
+   frame_lock. */
+static bool
+make_room (struct thread *t)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  return t->vmstat.resident < t->rss_hard_limit || frame_evict_own (t);
+}
+
+/* Writes resident, memory-mapped page P back to its file under
+   filesys_lock, so that it cannot interleave with a write() to
+   the same file.  The caller holds frame_lock, which comes after
+   filesys_lock in the lock order, so unless the caller already
+   holds filesys_lock this only tries to acquire it.  Returns
+   true if successful, false if another thread holds
+   filesys_lock. */
+static bool
+page_write_back (struct page *p)
+{
+  bool had_lock = lock_held_by_current_thread (&filesys_lock);
+
+  ASSERT (p->mmap && p->frame != NULL);
+
+  if (!had_lock && !lock_try_acquire (&filesys_lock))
+    return false;
+  file_write_at (p->file, p->frame->kpage, p->read_bytes, p->file_ofs);
+  if (!had_lock)
+    lock_release (&filesys_lock);
+  p->dirty = false;
+  return true;
+}
+
+/* Creates a page at UPAGE with the given initial contents and
+   adds it to the current process's supplemental page table.
+   Returns the new page, or a null pointer if UPAGE is already
+   part of the address space or memory allocation fails. */
+static struct page *
+page_create (void *upage, struct file *file, off_t ofs,
+             size_t read_bytes, bool writable)
+{
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (read_bytes <= PGSIZE);
+
+  p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->upage = upage;
+  p->writable = writable;
+  p->owner = thread_current ();
+  p->frame = NULL;
+  p->dirty = false;
+  p->swap_slot = SWAP_NONE;
+  p->mmap = false;
+  p->file = read_bytes > 0 ? file : NULL;
+  p->file_ofs = ofs;
+  p->read_bytes = read_bytes;
+  if (!page_insert (p))
+    {
+      free (p);
+      return NULL;
+    }
+  return p;
+}
+
+/* Inserts P into the current process's supplemental page table.
+   Returns false if a page already exists at P's address. */
+static bool
+page_insert (struct page *p)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (t->pages != NULL);
+  return hash_insert (t->pages, &p->hash_elem) == NULL;
+}
+
+/* Frees the page at E, along with its frame or swap slot,
+   writing it back first if it is a modified memory-mapped page.
+   The caller must hold frame_lock. */
+static void
+page_destroy (struct hash_elem *e, void *aux UNUSED)
+{
+  struct page *p = hash_entry (e, struct page, hash_elem);
+
+  if (p->frame != NULL)
+    {
+      uint32_t *pd = p->owner->pagedir;
+
+      if (p->mmap && (p->dirty || pagedir_is_dirty (pd, p->upage)))
+        {
+          /* Unmapping holds filesys_lock; see mmap_release(). */
+          ASSERT (lock_held_by_current_thread (&filesys_lock));
+          page_write_back (p);
+        }
+      pagedir_clear_page (pd, p->upage);
+      if (p->frame != frame_zero ())
+        p->owner->vmstat.resident--;
+      frame_remove_page (p->frame, p);
+    }
+  if (p->swap_slot != SWAP_NONE)
+    {
+      swap_free (p->swap_slot);
+      p->owner->vmstat.swapped--;
+    }
+  free (p);
+}
+
+/* Returns a hash value for the page at E. */
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return hash_bytes (&p->upage, sizeof p->upage);
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+
+  return a->upage < b->upage;
+}
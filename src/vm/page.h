@@ -0,0 +1,82 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct thread;
+
+/* A page of a process's virtual address space, as recorded in
+   its supplemental page table.
+
+   The hardware page table only says where a page is while it is
+   resident.  The supplemental page table also remembers where a
+   page's contents come from when it is not, so that the page
+   fault handler can bring it in on first access. */
+struct page
+  {
+    void *upage;                /* User virtual address. */
+    bool writable;              /* Read/write or read-only? */
+    struct thread *owner;       /* Process whose address space this is. */
+    struct frame *frame;        /* Frame holding the page, if resident. */
+    struct list_elem frame_elem; /* Element in frame's `pages'. */
+
+    /* Where the page's contents are while it is not resident.
+       A page that was modified since it was loaded (DIRTY) is
+       written to swap on eviction, in slot SWAP_SLOT, unless
+       it is memory-mapped (see below); a clean
+       page is just dropped and reloaded from its file or
+       zero-filled again. */
+    bool dirty;                 /* Modified since loaded from FILE? */
+    size_t swap_slot;           /* Swap slot, or SWAP_NONE. */
+    bool mmap;                  /* Memory-mapped: write back to FILE. */
+
+    /* Initial contents: READ_BYTES bytes from FILE at offset
+       FILE_OFS, then zeros to the end of the page.  FILE is
+       null for a page that starts out all zeros.  A page of a
+       memory-mapped file is written back to the same place
+       instead of to swap. */
+    struct file *file;
+    off_t file_ofs;
+    size_t read_bytes;
+
+    struct hash_elem hash_elem; /* Element in supplemental page table. */
+  };
+
+/* Maximum size of a user stack, in pages. */
+#define STACK_PAGES_DEFAULT 2048        /* 8 MB. */
+extern size_t stack_page_limit;
+
+/* Print each process's struct vmstat when it exits? */
+extern bool page_stats_report;
+
+/* Default limits on a process's resident pages. */
+extern size_t rss_soft_page_limit;
+extern size_t rss_hard_page_limit;
+
+bool page_table_create (void);
+bool page_table_fork (struct thread *parent, struct file *exec);
+void page_table_destroy (void);
+
+struct page *page_lookup (const void *uaddr);
+bool page_alloc_file (void *upage, struct file *, off_t ofs,
+                      size_t read_bytes, bool writable);
+bool page_alloc_zero (void *upage, bool writable);
+bool page_alloc_mmap (void *upage, struct file *, off_t ofs,
+                      size_t read_bytes);
+void page_free (void *upage);
+bool page_in (const void *uaddr);
+bool page_copy_on_write (const void *uaddr);
+bool page_grow_stack (const void *uaddr);
+bool page_is_stack (const void *uaddr);
+bool page_pin_range (const void *uaddr, size_t size, bool will_write);
+void page_unpin_range (const void *uaddr, size_t size);
+void page_print_stats (void);
+
+bool page_accessed_recently (struct page *);
+bool page_out (struct page *);
+
+#endif /* vm/page.h */
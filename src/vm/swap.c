@@ -0,0 +1,92 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Swap space.
+
+   The swap device is divided into page-sized slots of
+   PAGE_SECTORS consecutive sectors each.  A bitmap records which
+   slots are in use.  Evicted pages whose contents cannot be
+   recovered from anywhere else are written to a free slot and
+   read back when they are next faulted in. */
+
+/* Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Swap device, or a null pointer if there is none. */
+static struct block *swap_device;
+
+/* Used swap slots, or a null pointer if there is no swap device. */
+static struct bitmap *swap_map;
+static struct lock swap_lock;
+
+/* Finds the swap device and sets up the slot bitmap.  Without a
+   swap device, eviction can only discard pages that can be
+   reread from their files. */
+void
+swap_init (void)
+{
+  lock_init (&swap_lock);
+  lock_set_name (&swap_lock, "swap");
+
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device == NULL)
+    {
+      printf ("swap: no swap device, modified pages cannot be evicted\n");
+      return;
+    }
+  swap_map = bitmap_create (block_size (swap_device) / PAGE_SECTORS);
+  if (swap_map == NULL)
+    PANIC ("swap: bitmap creation failed");
+}
+
+/* Writes the page at KPAGE to a free swap slot and returns the
+   slot's index, or SWAP_NONE if swap is full. */
+size_t
+swap_out (const void *kpage)
+{
+  size_t slot;
+  size_t i;
+
+  if (swap_map == NULL)
+    return SWAP_NONE;
+
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip (swap_map, 0, 1, false);
+  lock_release (&swap_lock);
+  if (slot == BITMAP_ERROR)
+    return SWAP_NONE;
+
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_write (swap_device, slot * PAGE_SECTORS + i,
+                 (const uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+  return slot;
+}
+
+/* Reads swap slot SLOT into the page at KPAGE.  The slot remains
+   in use until freed with swap_free(). */
+void
+swap_in (size_t slot, void *kpage)
+{
+  size_t i;
+
+  ASSERT (bitmap_test (swap_map, slot));
+
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_read (swap_device, slot * PAGE_SECTORS + i,
+                (uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+}
+
+/* Marks swap slot SLOT free. */
+void
+swap_free (size_t slot)
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_map, slot));
+  bitmap_reset (swap_map, slot);
+  lock_release (&swap_lock);
+}